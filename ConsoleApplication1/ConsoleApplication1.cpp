@@ -1,268 +1,1755 @@
 ﻿#include <iostream>
 #include <fstream>
 #include <iterator>
+#include <iomanip>
 #include <algorithm>
 #include <cctype>
 #include <locale>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <exception>
+#include <cstdio>
+#include <cstdint>
+#include <new>
+#include <random>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DATA_MANAGER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-// Шаблонный класс DataManager для работы с однотипным набором данных
-template <typename T, size_t MAX_SIZE = 64>
-class DataManager {
+// Память кольцевого буфера внутри объекта, емкость задана при компиляции
+template <typename T, size_t CAPACITY>
+class InlineStorage {
 private:
-    T data[MAX_SIZE];          // Массив для хранения данных
-    size_t current_size;        // Текущее количество элементов в наборе
-    const std::string DUMP_FILE = "dump.dat"; // Имя файла для выгрузки данных
-
-    // Метод для смещения всех элементов вправо
-    void shiftRight() {
-        if (current_size > 0) {
-            // Перемещаем каждый элемент на одну позицию вправо
-            for (size_t i = current_size; i > 0; --i) {
-                data[i] = data[i - 1];
+    T items[CAPACITY];
+
+public:
+    T* data() { return items; }
+    const T* data() const { return items; }
+    size_t capacity() const { return CAPACITY; }
+};
+
+// Память кольцевого буфера во внешнем блоке, емкость задана при создании
+template <typename T>
+class BlockStorage {
+private:
+    T* items;
+    size_t length;
+
+public:
+    BlockStorage(T* block, size_t capacity) : items(block), length(capacity) {}
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    size_t capacity() const { return length; }
+};
+
+// Кольцевой буфер с вставкой и удалением с обоих концов за O(1).
+// Storage - память элементов (InlineStorage или BlockStorage)
+template <typename T, typename Storage>
+class RingBuffer {
+private:
+    Storage items;       // Хранилище элементов
+    size_t head;         // Физический индекс первого элемента
+    size_t count;        // Количество элементов в буфере
+
+    // Перевод логического индекса в физический
+    size_t physical(size_t i) const {
+        size_t pos = head + i;
+        return pos >= items.capacity() ? pos - items.capacity() : pos;
+    }
+
+public:
+    RingBuffer() : head(0), count(0) {}
+
+    // Буфер поверх внешнего блока из capacity элементов
+    RingBuffer(T* block, size_t capacity) : items(block, capacity), head(0), count(0) {}
+
+    void pushFront(const T& elem) {
+        head = head == 0 ? items.capacity() - 1 : head - 1;
+        items.data()[head] = elem;
+        ++count;
+    }
+
+    void pushBack(const T& elem) {
+        items.data()[physical(count)] = elem;
+        ++count;
+    }
+
+    T popFront() {
+        T elem = items.data()[head];
+        head = head + 1 == items.capacity() ? 0 : head + 1;
+        --count;
+        return elem;
+    }
+
+    T popBack() {
+        --count;
+        return items.data()[physical(count)];
+    }
+
+    const T& back() const { return items.data()[physical(count - 1)]; }
+
+    // Копирование содержимого в логическом порядке (не более двух непрерывных блоков)
+    void copyTo(T* out) const {
+        const T* base = items.data();
+        size_t first = std::min(count, items.capacity() - head);
+        std::copy(base + head, base + head + first, out);
+        std::copy(base, base + (count - first), out + first);
+    }
+
+    // Замена содержимого n элементами из массива
+    void assign(const T* in, size_t n) {
+        std::copy(in, in + n, items.data());
+        head = 0;
+        count = n;
+    }
+
+    void clear() { head = 0; count = 0; }
+
+    size_t size() const { return count; }
+};
+
+// Хранилище набора с быстрым доступом к началу и к центральному элементу.
+// Набор разбит на две половины: левая хранит элементы [0, center], правая - остальные,
+// поэтому центральный элемент всегда находится в конце левой половины.
+// Вставка в начало и извлечение центра выполняются за O(1) вместо сдвига массива.
+// Storage - память каждой из половин (InlineStorage или BlockStorage)
+template <typename T, typename Storage>
+class CenterBuffer {
+private:
+    RingBuffer<T, Storage> left;    // Элементы от начала до центрального включительно
+    RingBuffer<T, Storage> right;   // Элементы после центрального
+
+public:
+    CenterBuffer() {}
+
+    // Обе половины по half элементов размещаются подряд во внешнем блоке
+    CenterBuffer(T* block, size_t half) : left(block, half), right(block + half, half) {}
+
+    // Вставка элемента в начало набора
+    void pushFront(const T& elem) {
+        // При нечетном размере центр после вставки сместится на один элемент левее
+        if (size() % 2 == 1) {
+            right.pushFront(left.popBack());
+        }
+        left.pushFront(elem);
+    }
+
+    // Центральный элемент (для четного количества - первый слева от центра)
+    const T& center() const { return left.back(); }
+
+    // Извлечение центрального элемента
+    T popCenter() {
+        T elem = left.popBack();
+        // При четном исходном размере центр смещается на один элемент правее
+        if (left.size() < right.size()) {
+            left.pushBack(right.popFront());
+        }
+        return elem;
+    }
+
+    // Копирование набора в массив в логическом порядке
+    void copyTo(T* out) const {
+        left.copyTo(out);
+        right.copyTo(out + left.size());
+    }
+
+    // Заполнение набора n элементами массива в логическом порядке
+    void assign(const T* in, size_t n) {
+        size_t half = (n + 1) / 2;
+        left.assign(in, half);
+        right.assign(in + half, n - half);
+    }
+
+    void clear() {
+        left.clear();
+        right.clear();
+    }
+
+    size_t size() const { return left.size() + right.size(); }
+};
+
+// Счетчики операций выгрузки для оценки затрат на ввод-вывод
+struct SpillStats {
+    size_t bytesSpilled = 0;   // Сколько байт выгружено
+    size_t spillCount = 0;     // Сколько раз выполнялась выгрузка
+    size_t syscalls = 0;       // Сколько обращений к файлу (позиционирование, запись, чтение)
+    size_t rawBytes = 0;       // Объем выгруженных данных до кодирования
+};
+
+// Путь к файлу выгрузки. Если путь не задан, выбирается уникальное имя,
+// а файл удаляется вместе с владельцем
+class DumpPath {
+private:
+    std::string path;
+    bool temporary;
+
+    // Уникальное имя из времени запуска и номера экземпляра
+    static std::string uniqueName() {
+        static std::atomic<unsigned long> counter(0);
+        auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+        return "dump_" + std::to_string(ticks) + "_" + std::to_string(counter++) + ".dat";
+    }
+
+public:
+    explicit DumpPath(const std::string& requested)
+        : path(requested.empty() ? uniqueName() : requested), temporary(requested.empty()) {}
+
+    DumpPath(const DumpPath&) = delete;
+    DumpPath& operator=(const DumpPath&) = delete;
+
+    ~DumpPath() {
+        if (temporary) {
+            std::remove(path.c_str());
+        }
+    }
+
+    const std::string& str() const { return path; }
+};
+
+// Файл выгрузки, открытый на все время жизни владельца.
+// Данные хранятся как последовательность сегментов (по одному на каждую выгрузку набора),
+// а границы сегментов - в индексе в памяти. Последний сегмент извлекается за одно чтение
+// и сдвиг логического конца файла, без перезаписи и переоткрытия файла.
+// Записи копятся в буфере и сбрасываются на диск крупными блоками
+class SpillFile {
+private:
+    std::fstream file;                  // Открытый файл выгрузки
+    std::vector<char> pending;          // Еще не записанные на диск байты
+    size_t bufferLimit;                 // Размер буфера записи
+    size_t diskSize;                    // Логический размер данных на диске
+    std::vector<size_t> segmentStarts;  // Смещения начала сегментов
+    SpillStats stats;
+
+    // Запись байтов на диск по логическому концу файла
+    void writeToDisk(const char* bytes, size_t count) {
+        file.clear();
+        file.seekp(static_cast<std::streamoff>(diskSize));
+        file.write(bytes, count);
+        stats.syscalls += 2;
+        if (!file) {
+            throw std::runtime_error("Не удалось записать в файл выгрузки");
+        }
+        diskSize += count;
+    }
+
+    // Добавление байтов в конец файла
+    void write(const char* bytes, size_t count) {
+        if (pending.size() + count > bufferLimit) {
+            flush();
+        }
+        if (count > bufferLimit) {
+            // Крупный блок пишем напрямую, минуя буфер
+            writeToDisk(bytes, count);
+        }
+        else {
+            pending.insert(pending.end(), bytes, bytes + count);
+        }
+    }
+
+    // Чтение байтов с заданного смещения с учетом еще не записанного буфера
+    void read(size_t offset, char* out, size_t count) {
+        size_t fromDisk = offset < diskSize ? std::min(count, diskSize - offset) : 0;
+        if (fromDisk > 0) {
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(out, fromDisk);
+            stats.syscalls += 2;
+            if (file.gcount() != static_cast<std::streamsize>(fromDisk)) {
+                throw std::runtime_error("Не удалось прочитать файл выгрузки");
             }
         }
+        if (count > fromDisk) {
+            size_t bufferOffset = offset + fromDisk - diskSize;
+            std::copy(pending.begin() + bufferOffset, pending.begin() + bufferOffset + (count - fromDisk),
+                out + fromDisk);
+        }
     }
 
-    // Метод для определения центрального индекса
-    size_t getCenterIndex() const {
-        if (current_size == 0) return 0;
-        // Для четного количества - первый элемент слева от центра
-        return current_size % 2 == 0 ? (current_size / 2) - 1 : current_size / 2;
+    // Отбрасывание данных после указанного размера
+    void truncate(size_t newSize) {
+        if (newSize >= diskSize) {
+            pending.resize(newSize - diskSize);
+        }
+        else {
+            pending.clear();
+            diskSize = newSize;
+        }
     }
 
 public:
-    // Конструктор - инициализация пустого набора
-    DataManager() : current_size(0) {}
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
 
-    // Добавление одного элемента в набор
-    void push(T elem) {
-        // Если набор заполнен - выгружаем данные в файл
-        if (current_size >= MAX_SIZE) {
-            dumpToFile();
+    SpillFile(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : bufferLimit(bufferSize), diskSize(0) {
+        // Отключаем буфер потока, чтобы каждая операция соответствовала одному обращению к ОС
+        file.rdbuf()->pubsetbuf(nullptr, 0);
+        file.open(path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Не удалось открыть файл выгрузки: " + path);
         }
+        pending.reserve(bufferLimit);
+    }
 
-        // Смещаем существующие элементы вправо
-        shiftRight();
+    ~SpillFile() {
+        // Ошибку записи при закрытии сообщить уже некому
+        try {
+            flush();
+        }
+        catch (const std::exception&) {
+        }
+    }
 
-        // Вставляем новый элемент в начало
-        data[0] = elem;
+    // Запись подряд идущих сегментов заданных размеров одной операцией.
+    // Сегменты попадают в индекс только после успешной записи
+    void pushSegments(const char* bytes, const size_t* sizes, size_t segments) {
+        size_t start = size();
+        size_t count = 0;
+        for (size_t i = 0; i < segments; ++i) {
+            count += sizes[i];
+        }
+        write(bytes, count);
+        for (size_t i = 0; i < segments; ++i) {
+            segmentStarts.push_back(start);
+            start += sizes[i];
+        }
+        stats.bytesSpilled += count;
+        ++stats.spillCount;
+    }
 
-        // Увеличиваем размер, если не достигнут максимум
-        if (current_size < MAX_SIZE) {
-            ++current_size;
+    // Извлечение последнего записанного сегмента, возвращает его размер в байтах
+    size_t popSegment(char* out, size_t capacity) {
+        if (segmentStarts.empty()) return 0;
+
+        size_t start = segmentStarts.back();
+        size_t count = std::min(size() - start, capacity);
+        read(start, out, count);
+        truncate(start);
+        segmentStarts.pop_back();
+        return count;
+    }
+
+    // Сброс буфера записи на диск
+    void flush() {
+        if (!pending.empty()) {
+            writeToDisk(pending.data(), pending.size());
+            pending.clear();
         }
     }
 
-    // Добавление группы элементов
-    void push(T elems[], size_t n) {
-        for (size_t i = 0; i < n; ++i) {
-            push(elems[i]);
+    // Общий размер выгруженных данных
+    size_t size() const { return diskSize + pending.size(); }
+
+    // Количество сегментов в файле
+    size_t segmentCount() const { return segmentStarts.size(); }
+
+    SpillStats getStats() const { return stats; }
+};
+
+#if defined(__linux__)
+// Файл выгрузки, отображенный в память. Интерфейс совпадает со SpillFile,
+// но выгрузка и загрузка сегмента сводятся к копированию в отображение:
+// поток ввода-вывода не используется, а обращения к ОС нужны только при росте файла
+class MappedSpillFile {
+private:
+    int fd;                             // Дескриптор файла выгрузки
+    char* base;                         // Начало отображения
+    size_t mapped;                      // Размер отображения
+    size_t used;                        // Логический размер данных
+    std::vector<size_t> segmentStarts;  // Смещения начала сегментов
+    SpillStats stats;
+
+    // Расширение файла и отображения не менее чем до need байт
+    void reserve(size_t need) {
+        if (need <= mapped) return;
+
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t newSize = std::max(need, mapped * 2);
+        newSize = (newSize + page - 1) / page * page;
+
+        if (ftruncate(fd, static_cast<off_t>(newSize)) != 0) {
+            throw std::runtime_error("Не удалось расширить файл выгрузки");
+        }
+        void* area = base == nullptr
+            ? mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+            : mremap(base, mapped, newSize, MREMAP_MAYMOVE);
+        if (area == MAP_FAILED) {
+            throw std::runtime_error("Не удалось отобразить файл выгрузки в память");
         }
+        base = static_cast<char*>(area);
+        mapped = newSize;
+        stats.syscalls += 2;
     }
 
-    // Возврат центрального элемента без извлечения
-    T peek() const {
-        if (current_size == 0) return T();
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
 
-        // Получаем центральный индекс
-        size_t center = getCenterIndex();
-        return data[center];
+    // Размер буфера задает начальный размер отображения
+    MappedSpillFile(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : fd(-1), base(nullptr), mapped(0), used(0) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Не удалось открыть файл выгрузки: " + path);
+        }
+        // Деструктор не вызовется для недостроенного объекта - закрываем файл сами
+        try {
+            reserve(std::max<size_t>(bufferSize, 1));
+        }
+        catch (...) {
+            close(fd);
+            throw;
+        }
     }
 
-    // Извлечение центрального элемента
-    T pop() {
-        if (current_size == 0) return T();
+    MappedSpillFile(const MappedSpillFile&) = delete;
+    MappedSpillFile& operator=(const MappedSpillFile&) = delete;
 
-        // Находим центральный индекс
-        size_t center = getCenterIndex();
-        T elem = data[center];
+    ~MappedSpillFile() {
+        if (base != nullptr) munmap(base, mapped);
+        // Отрезаем неиспользованный хвост отображения, ошибка при закрытии не критична
+        int rc = ftruncate(fd, static_cast<off_t>(used));
+        (void)rc;
+        close(fd);
+    }
 
-        // Смещаем элементы влево, перезаписывая центральный
-        for (size_t i = center; i < current_size - 1; ++i) {
-            data[i] = data[i + 1];
+    // Запись подряд идущих сегментов заданных размеров
+    void pushSegments(const char* bytes, const size_t* sizes, size_t segments) {
+        size_t count = 0;
+        for (size_t i = 0; i < segments; ++i) {
+            segmentStarts.push_back(used + count);
+            count += sizes[i];
         }
+        reserve(used + count);
+        std::memcpy(base + used, bytes, count);
+        used += count;
+        stats.bytesSpilled += count;
+        ++stats.spillCount;
+    }
 
-        // Уменьшаем размер
-        --current_size;
+    // Извлечение последнего записанного сегмента, возвращает его размер в байтах
+    size_t popSegment(char* out, size_t capacity) {
+        if (segmentStarts.empty()) return 0;
 
-        // Если набор пуст, пробуем загрузить из файла дампа
-        if (current_size == 0) {
-            loadFromDumpFile();
+        size_t start = segmentStarts.back();
+        size_t count = std::min(used - start, capacity);
+        std::memcpy(out, base + start, count);
+        used = start;
+        segmentStarts.pop_back();
+        return count;
+    }
+
+    // Данные попадают в файл через отображение, отдельный сброс не нужен
+    void flush() {}
+
+    size_t size() const { return used; }
+
+    size_t segmentCount() const { return segmentStarts.size(); }
+
+    SpillStats getStats() const { return stats; }
+};
+#else
+// Отображение файлов реализовано только для Linux, на остальных платформах
+// используется буферизованный файл выгрузки
+using MappedSpillFile = SpillFile;
+#endif
+
+// Асинхронная выгрузка поверх файла Spill. Выгружаемый блок копируется в запасной
+// буфер и передается фоновому потоку, поэтому вызывающий поток не ждет диска.
+// Очередь ограничена MAX_QUEUED блоками: если диск не успевает, выгрузка ждет записи.
+// Ошибка фонового потока передается вызывающему при следующем обращении.
+// При загрузке фоновый поток заранее читает следующий сегмент файла
+template <typename Spill = SpillFile>
+class AsyncSpillFile {
+public:
+    static const size_t MAX_QUEUED = 2;      // Наибольшее число блоков в очереди на запись
+
+private:
+    // Блок, ожидающий записи в файл
+    struct Block {
+        std::vector<char> bytes;
+        std::vector<size_t> sizes;   // Размеры сегментов блока
+    };
+
+    Spill file;                              // Файл, с которым работает фоновый поток
+    std::vector<char> prefetched;            // Заранее прочитанный последний сегмент файла
+    bool hasPrefetched;
+    size_t maxSegmentSize;                   // Размер буфера для предварительного чтения
+    std::deque<Block> queue;                 // Блоки, еще не записанные в файл (новые - в конце)
+    std::vector<Block> spare;                // Освободившиеся буферы для повторного использования
+    bool writing;                            // Фоновый поток записывает блок
+    bool prefetchRequested;
+    bool stopping;
+    std::exception_ptr failure;              // Ошибка фонового потока
+    SpillStats stats;
+    mutable std::mutex stateMutex;           // Защищает очередь, флаги и счетчики
+    mutable std::mutex ioMutex;              // Защищает файл и прочитанный заранее сегмент
+    std::condition_variable wake;            // Пробуждение фонового потока
+    std::condition_variable idle;            // Окончание записи блока или освобождение места в очереди
+    std::thread worker;
+
+    // Передача ошибки фонового потока вызывающему (под stateMutex).
+    // После ошибки часть выгруженных данных потеряна, поэтому ошибка не сбрасывается
+    void rethrowFailure() const {
+        if (failure) {
+            std::rethrow_exception(failure);
         }
+    }
 
-        return elem;
+    // Возврат прочитанного заранее сегмента в файл (под ioMutex)
+    void returnPrefetched() {
+        if (hasPrefetched) {
+            size_t segmentSize = prefetched.size();
+            file.pushSegments(prefetched.data(), &segmentSize, 1);
+            hasPrefetched = false;
+        }
     }
 
-    // Выгрузка данных в файл при заполнении
-    void dumpToFile() {
-        // Открываем файл для добавления в конец в бинарном режиме
-        std::ofstream dump(DUMP_FILE, std::ios::app | std::ios::binary);
-        dump.write(reinterpret_cast<char*>(data), current_size * sizeof(T));
-        dump.close();
-        current_size = 0;
+    // Чтение последнего сегмента файла в буфер (под ioMutex)
+    void prefetch() {
+        if (hasPrefetched || file.segmentCount() == 0) return;
+        prefetched.resize(maxSegmentSize);
+        prefetched.resize(file.popSegment(prefetched.data(), prefetched.size()));
+        hasPrefetched = !prefetched.empty();
     }
 
-    // Загрузка данных из файла дампа
-    void loadFromDumpFile() {
-        std::ifstream dump(DUMP_FILE, std::ios::binary);
-        if (dump) {
-            // Определяем размер файла
-            dump.seekg(0, std::ios::end);
-            size_t file_size = dump.tellg() / sizeof(T);
-
-            if (file_size > 0) {
-                dump.seekg(0, std::ios::beg);
-                // Считываем данные, не превышая размер массива
-                size_t read_size = std::min(file_size, MAX_SIZE);
-                dump.read(reinterpret_cast<char*>(data), read_size * sizeof(T));
-                current_size = read_size;
-
-                // Очищаем файл после чтения
-                dump.close();
-                std::ofstream truncate(DUMP_FILE, std::ios::trunc);
-                truncate.close();
+    // Цикл фонового потока
+    void run() {
+        std::unique_lock<std::mutex> state(stateMutex);
+        for (;;) {
+            wake.wait(state, [this] { return stopping || prefetchRequested || !queue.empty(); });
+
+            if (!queue.empty()) {
+                // Блоки записываются в порядке выгрузки
+                Block block = std::move(queue.front());
+                queue.pop_front();
+                writing = true;
+                std::unique_lock<std::mutex> io(ioMutex);
+                state.unlock();
+
+                std::exception_ptr error;
+                try {
+                    // Прочитанный заранее сегмент старше нового блока - возвращаем его в файл
+                    returnPrefetched();
+                    file.pushSegments(block.bytes.data(), block.sizes.data(), block.sizes.size());
+                    for (size_t segmentSize : block.sizes) {
+                        maxSegmentSize = std::max(maxSegmentSize, segmentSize);
+                    }
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                io.unlock();
+                state.lock();
+                if (error && !failure) {
+                    failure = error;
+                }
+                writing = false;
+                spare.push_back(std::move(block));
+                idle.notify_all();
+            }
+            else if (prefetchRequested) {
+                prefetchRequested = false;
+                std::unique_lock<std::mutex> io(ioMutex);
+                state.unlock();
+                std::exception_ptr error;
+                try {
+                    prefetch();
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+                io.unlock();
+                state.lock();
+                if (error && !failure) {
+                    failure = error;
+                }
+            }
+            else {
+                return;
             }
         }
     }
 
-    // Получение текущего размера набора
-    size_t size() const { return current_size; }
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = Spill::DEFAULT_BUFFER_SIZE;
+
+    AsyncSpillFile(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : file(path, bufferSize), hasPrefetched(false), maxSegmentSize(0),
+        writing(false), prefetchRequested(false), stopping(false) {
+        worker = std::thread(&AsyncSpillFile::run, this);
+    }
+
+    ~AsyncSpillFile() {
+        {
+            std::lock_guard<std::mutex> state(stateMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        // Ошибку записи при закрытии сообщить уже некому
+        try {
+            returnPrefetched();
+        }
+        catch (const std::exception&) {
+        }
+    }
+
+    // Постановка блока в очередь на запись. Возвращает управление сразу,
+    // если в очереди есть место, иначе ждет записи предыдущего блока
+    void pushSegments(const char* bytes, const size_t* sizes, size_t segments) {
+        std::unique_lock<std::mutex> state(stateMutex);
+        idle.wait(state, [this] { return queue.size() < MAX_QUEUED || failure; });
+        rethrowFailure();
+
+        Block block;
+        if (!spare.empty()) {
+            block = std::move(spare.back());
+            spare.pop_back();
+        }
+        block.sizes.assign(sizes, sizes + segments);
+        size_t count = 0;
+        for (size_t i = 0; i < segments; ++i) {
+            count += sizes[i];
+        }
+        block.bytes.assign(bytes, bytes + count);
+        queue.push_back(std::move(block));
+        stats.bytesSpilled += count;
+        ++stats.spillCount;
+        wake.notify_one();
+    }
+
+    // Извлечение последнего выгруженного сегмента, возвращает его размер в байтах
+    size_t popSegment(char* out, size_t capacity) {
+        std::lock_guard<std::mutex> state(stateMutex);
+        rethrowFailure();
+
+        // Сегмент, еще не записанный на диск, отдаем прямо из очереди
+        if (!queue.empty()) {
+            Block& block = queue.back();
+            size_t start = block.bytes.size() - block.sizes.back();
+            size_t count = std::min(block.sizes.back(), capacity);
+            std::copy(block.bytes.begin() + start, block.bytes.begin() + start + count, out);
+            block.bytes.resize(start);
+            block.sizes.pop_back();
+            if (block.sizes.empty()) {
+                spare.push_back(std::move(block));
+                queue.pop_back();
+                idle.notify_all();
+            }
+            return count;
+        }
+
+        // Иначе дожидаемся записи текущего блока и берем сегмент из файла
+        std::lock_guard<std::mutex> io(ioMutex);
+        size_t count = 0;
+        if (hasPrefetched) {
+            count = std::min(prefetched.size(), capacity);
+            std::copy(prefetched.begin(), prefetched.begin() + count, out);
+            hasPrefetched = false;
+        }
+        else {
+            count = file.popSegment(out, capacity);
+        }
+
+        // Следующий сегмент читаем заранее в фоновом потоке
+        if (file.segmentCount() > 0) {
+            prefetchRequested = true;
+            wake.notify_one();
+        }
+        return count;
+    }
+
+    // Ожидание записи всех блоков очереди и сброс файла
+    void flush() {
+        std::unique_lock<std::mutex> state(stateMutex);
+        idle.wait(state, [this] { return (queue.empty() && !writing) || failure; });
+        rethrowFailure();
+        std::lock_guard<std::mutex> io(ioMutex);
+        file.flush();
+    }
+
+    // Общий размер выгруженных данных
+    size_t size() const {
+        std::lock_guard<std::mutex> state(stateMutex);
+        std::lock_guard<std::mutex> io(ioMutex);
+        size_t total = file.size() + (hasPrefetched ? prefetched.size() : 0);
+        for (const Block& block : queue) {
+            total += block.bytes.size();
+        }
+        return total;
+    }
+
+    // Количество сегментов с учетом очереди и прочитанного заранее сегмента
+    size_t segmentCount() const {
+        std::lock_guard<std::mutex> state(stateMutex);
+        std::lock_guard<std::mutex> io(ioMutex);
+        size_t total = file.segmentCount() + (hasPrefetched ? 1 : 0);
+        for (const Block& block : queue) {
+            total += block.sizes.size();
+        }
+        return total;
+    }
+
+    // Объем и число выгрузок считаются при постановке в очередь, обращения к ОС - по файлу
+    SpillStats getStats() const {
+        std::lock_guard<std::mutex> state(stateMutex);
+        std::lock_guard<std::mutex> io(ioMutex);
+        SpillStats result = stats;
+        result.syscalls = file.getStats().syscalls;
+        return result;
+    }
 };
 
-// Явная специализация для символьного типа
-template <>
-class DataManager<char, 64> {
-private:
-    char data[64];
-    size_t current_size;
-    const std::string DUMP_FILE = "dump.dat";
-
-    // Метод для смещения элементов вправо
-    void shiftRight() {
-        if (current_size > 0) {
-            for (size_t i = current_size; i > 0; --i) {
-                data[i] = data[i - 1];
+// Кодеки выгрузки. Кодек преобразует блок элементов в байты сегмента и обратно:
+//   maxEncodedSize<T>(n) - верхняя граница размера закодированного блока;
+//   encode(in, n, out)   - дописывает закодированный блок в out;
+//   decode(in, bytes, out) - восстанавливает элементы, возвращает их количество.
+
+// Запись элементов как есть
+struct RawCodec {
+    template <typename T>
+    static size_t maxEncodedSize(size_t n) { return n * sizeof(T); }
+
+    template <typename T>
+    static void encode(const T* in, size_t n, std::vector<char>& out) {
+        const char* bytes = reinterpret_cast<const char*>(in);
+        out.insert(out.end(), bytes, bytes + n * sizeof(T));
+    }
+
+    template <typename T>
+    static size_t decode(const char* in, size_t bytes, T* out) {
+        std::memcpy(out, in, bytes);
+        return bytes / sizeof(T);
+    }
+};
+
+// Разности соседних элементов в zigzag-кодировке, записанные как varint.
+// Для монотонных счетчиков каждая разность занимает один-два байта
+struct DeltaVarintCodec {
+    template <typename T>
+    static size_t maxEncodedSize(size_t n) { return n * ((sizeof(T) * 8 + 6) / 7); }
+
+    template <typename T>
+    static void encode(const T* in, size_t n, std::vector<char>& out) {
+        static_assert(std::is_integral<T>::value, "DeltaVarintCodec предназначен для целых типов");
+        typedef typename std::make_unsigned<T>::type U;
+        typedef typename std::make_signed<T>::type S;
+
+        U prev = 0;
+        for (size_t i = 0; i < n; ++i) {
+            // Разность по модулю 2^N, затем zigzag: малые по модулю значения - малые коды
+            S delta = static_cast<S>(static_cast<U>(static_cast<U>(in[i]) - prev));
+            U zigzag = static_cast<U>(static_cast<U>(delta) << 1) ^ static_cast<U>(delta >> (sizeof(T) * 8 - 1));
+            prev = static_cast<U>(in[i]);
+
+            while (zigzag >= 0x80) {
+                out.push_back(static_cast<char>((zigzag & 0x7F) | 0x80));
+                zigzag = static_cast<U>(zigzag >> 7);
             }
+            out.push_back(static_cast<char>(zigzag));
         }
     }
 
-    // Получение центрального индекса
-    size_t getCenterIndex() const {
-        if (current_size == 0) return 0;
-        return current_size % 2 == 0 ? (current_size / 2) - 1 : current_size / 2;
+    template <typename T>
+    static size_t decode(const char* in, size_t bytes, T* out) {
+        typedef typename std::make_unsigned<T>::type U;
+
+        U prev = 0;
+        size_t count = 0;
+        for (size_t pos = 0; pos < bytes; ++count) {
+            U zigzag = 0;
+            for (unsigned shift = 0;; shift += 7) {
+                unsigned char byte = static_cast<unsigned char>(in[pos++]);
+                zigzag |= static_cast<U>(static_cast<U>(byte & 0x7F) << shift);
+                if ((byte & 0x80) == 0) break;
+            }
+            U delta = static_cast<U>((zigzag >> 1) ^ static_cast<U>(0 - (zigzag & 1)));
+            prev = static_cast<U>(prev + delta);
+            out[count] = static_cast<T>(prev);
+        }
+        return count;
     }
+};
 
-    // Замена символов пунктуации на подчеркивание
-    char sanitizePunctuation(char c) {
-        return std::ispunct(static_cast<unsigned char>(c)) ? '_' : c;
+// XOR соседних значений с плавающей точкой (упрощенная схема Gorilla с точностью до байта):
+// записываются только значимые байты результата и заголовок с числом нулевых байтов по краям
+struct XorFloatCodec {
+    template <typename T>
+    static size_t maxEncodedSize(size_t n) { return n * (1 + sizeof(T)); }
+
+    template <typename T>
+    static void encode(const T* in, size_t n, std::vector<char>& out) {
+        static_assert(std::is_floating_point<T>::value && sizeof(T) <= 8,
+            "XorFloatCodec предназначен для float и double");
+
+        unsigned long long prev = 0;
+        for (size_t i = 0; i < n; ++i) {
+            unsigned long long bits = 0;
+            std::memcpy(&bits, &in[i], sizeof(T));
+            unsigned long long x = bits ^ prev;
+            prev = bits;
+
+            if (x == 0) {
+                // Значение повторяется
+                out.push_back(0);
+                continue;
+            }
+            unsigned lead = 0, trail = 0;
+            while (((x >> ((sizeof(T) - 1 - lead) * 8)) & 0xFF) == 0) ++lead;
+            while (((x >> (trail * 8)) & 0xFF) == 0) ++trail;
+
+            out.push_back(static_cast<char>(0x80 | (lead << 3) | trail));
+            for (unsigned b = trail; b < sizeof(T) - lead; ++b) {
+                out.push_back(static_cast<char>((x >> (b * 8)) & 0xFF));
+            }
+        }
     }
 
-public:
-    // Конструктор
-    DataManager() : current_size(0) {}
+    template <typename T>
+    static size_t decode(const char* in, size_t bytes, T* out) {
+        unsigned long long prev = 0;
+        size_t count = 0;
+        for (size_t pos = 0; pos < bytes; ++count) {
+            unsigned char header = static_cast<unsigned char>(in[pos++]);
+            unsigned long long x = 0;
+            if (header != 0) {
+                unsigned lead = (header >> 3) & 7, trail = header & 7;
+                for (unsigned b = trail; b < sizeof(T) - lead; ++b) {
+                    x |= static_cast<unsigned long long>(static_cast<unsigned char>(in[pos++])) << (b * 8);
+                }
+            }
+            prev ^= x;
+            std::memcpy(&out[count], &prev, sizeof(T));
+        }
+        return count;
+    }
+};
 
-    // Добавление одного символа с заменой пунктуации
-    void push(char elem) {
-        if (current_size >= 64) {
-            dumpToFile();
+// Кодирование повторов: пары (длина серии до 255, значение).
+// Подходит для символьных данных с длинными сериями одинаковых символов
+struct RunLengthCodec {
+    template <typename T>
+    static size_t maxEncodedSize(size_t n) { return n * (1 + sizeof(T)); }
+
+    template <typename T>
+    static void encode(const T* in, size_t n, std::vector<char>& out) {
+        for (size_t i = 0; i < n;) {
+            size_t run = 1;
+            while (i + run < n && run < 255 && std::memcmp(&in[i + run], &in[i], sizeof(T)) == 0) {
+                ++run;
+            }
+            const char* bytes = reinterpret_cast<const char*>(&in[i]);
+            out.push_back(static_cast<char>(run));
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+            i += run;
         }
+    }
 
-        shiftRight();
+    template <typename T>
+    static size_t decode(const char* in, size_t bytes, T* out) {
+        size_t count = 0;
+        for (size_t pos = 0; pos < bytes; pos += 1 + sizeof(T)) {
+            size_t run = static_cast<unsigned char>(in[pos]);
+            T value;
+            std::memcpy(&value, in + pos + 1, sizeof(T));
+            std::fill(out + count, out + count + run, value);
+            count += run;
+        }
+        return count;
+    }
+};
 
-        // Санация символа - замена пунктуации
-        data[0] = sanitizePunctuation(elem);
+// Обработка последовательностей символов блоками по 16 (SSE2) или 32 (AVX2) байта.
+// Векторный путь обрабатывает только ASCII; блоки с байтами >= 0x80 и остаток
+// обрабатываются посимвольно через функции <cctype>, поэтому результат совпадает
+// со скалярными вариантами при любой локали
+struct CharSpan {
+    // Замена пунктуации на подчеркивание, посимвольно
+    static void sanitizeScalar(const char* in, size_t n, char* out) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = std::ispunct(static_cast<unsigned char>(in[i])) ? '_' : in[i];
+        }
+    }
 
-        if (current_size < 64) {
-            ++current_size;
+    // Перевод в верхний регистр, посимвольно
+    static void toUpperScalar(char* text, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            text[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(text[i])));
         }
     }
 
-    // Добавление группы символов
-    void push(char elems[], size_t n) {
+    // Перевод в нижний регистр, посимвольно
+    static void toLowerScalar(char* text, size_t n) {
         for (size_t i = 0; i < n; ++i) {
-            push(elems[i]);
+            text[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+        }
+    }
+
+    // Замена пунктуации на подчеркивание
+    static void sanitize(const char* in, size_t n, char* out) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= n; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            if (_mm256_movemask_epi8(x) != 0) {
+                sanitizeScalar(in + i, 32, out + i);
+                continue;
+            }
+            // Пунктуация - видимые символы, кроме цифр и букв
+            __m256i graph = inRange(x, 0x21, 0x7E);
+            __m256i alnum = _mm256_or_si256(inRange(x, '0', '9'),
+                inRange(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z'));
+            __m256i punct = _mm256_andnot_si256(alnum, graph);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                _mm256_blendv_epi8(x, _mm256_set1_epi8('_'), punct));
+        }
+#endif
+#if defined(DATA_MANAGER_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (_mm_movemask_epi8(x) != 0) {
+                sanitizeScalar(in + i, 16, out + i);
+                continue;
+            }
+            __m128i graph = inRange(x, 0x21, 0x7E);
+            __m128i alnum = _mm_or_si128(inRange(x, '0', '9'),
+                inRange(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z'));
+            __m128i punct = _mm_andnot_si128(alnum, graph);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                _mm_or_si128(_mm_and_si128(punct, _mm_set1_epi8('_')), _mm_andnot_si128(punct, x)));
+        }
+#endif
+        sanitizeScalar(in + i, n - i, out + i);
+    }
+
+    // Перевод в верхний регистр
+    static void toUpper(char* text, size_t n) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= n; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+            if (_mm256_movemask_epi8(x) != 0) {
+                toUpperScalar(text + i, 32);
+                continue;
+            }
+            __m256i lower = _mm256_and_si256(inRange(x, 'a', 'z'), _mm256_set1_epi8(0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(text + i), _mm256_sub_epi8(x, lower));
+        }
+#endif
+#if defined(DATA_MANAGER_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            if (_mm_movemask_epi8(x) != 0) {
+                toUpperScalar(text + i, 16);
+                continue;
+            }
+            __m128i lower = _mm_and_si128(inRange(x, 'a', 'z'), _mm_set1_epi8(0x20));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(text + i), _mm_sub_epi8(x, lower));
+        }
+#endif
+        toUpperScalar(text + i, n - i);
+    }
+
+    // Перевод в нижний регистр
+    static void toLower(char* text, size_t n) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= n; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+            if (_mm256_movemask_epi8(x) != 0) {
+                toLowerScalar(text + i, 32);
+                continue;
+            }
+            __m256i upper = _mm256_and_si256(inRange(x, 'A', 'Z'), _mm256_set1_epi8(0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(text + i), _mm256_add_epi8(x, upper));
+        }
+#endif
+#if defined(DATA_MANAGER_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            if (_mm_movemask_epi8(x) != 0) {
+                toLowerScalar(text + i, 16);
+                continue;
+            }
+            __m128i upper = _mm_and_si128(inRange(x, 'A', 'Z'), _mm_set1_epi8(0x20));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(text + i), _mm_add_epi8(x, upper));
+        }
+#endif
+        toLowerScalar(text + i, n - i);
+    }
+
+private:
+#if defined(__AVX2__)
+    // Маска байтов из диапазона [lo, hi] (сравнение без знака)
+    static __m256i inRange(__m256i x, char lo, char hi) {
+        return _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(lo)), x),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(hi)), x));
+    }
+#endif
+#if defined(DATA_MANAGER_SSE2)
+    static __m128i inRange(__m128i x, char lo, char hi) {
+        return _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(lo)), x),
+            _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(hi)), x));
+    }
+#endif
+};
+
+// Политики обработки элементов при добавлении в набор
+
+// Элементы добавляются как есть
+struct KeepElements {
+    template <typename T>
+    static T apply(const T& elem) { return elem; }
+
+    template <typename T>
+    static void apply(const T* in, size_t n, T* out) { std::copy(in, in + n, out); }
+};
+
+// Пунктуация заменяется на подчеркивание (поведение DataManager<char>)
+struct ReplacePunctuation {
+    static char apply(char c) {
+        return std::ispunct(static_cast<unsigned char>(c)) ? '_' : c;
+    }
+
+    static void apply(const char* in, size_t n, char* out) { CharSpan::sanitize(in, n, out); }
+};
+
+// Распределители памяти для окна DynamicDataManager
+
+// Блоки, выровненные по границе строки кэша
+struct CacheAlignedAllocator {
+    static const size_t ALIGNMENT = 64;
+
+    void* allocate(size_t bytes) {
+        // Сдвиг до границы (от 1 до ALIGNMENT байт) хранится в байте перед блоком
+        char* raw = static_cast<char*>(::operator new(bytes + ALIGNMENT));
+        size_t shift = ALIGNMENT - reinterpret_cast<uintptr_t>(raw) % ALIGNMENT;
+        char* aligned = raw + shift;
+        aligned[-1] = static_cast<char>(shift);
+        return aligned;
+    }
+
+    void deallocate(void* block, size_t) {
+        char* aligned = static_cast<char*>(block);
+        ::operator delete(aligned - static_cast<unsigned char>(aligned[-1]));
+    }
+};
+
+#if defined(__linux__)
+// Блоки на больших страницах (2 МБ): сначала явные huge pages, при их отсутствии -
+// обычное отображение с рекомендацией ядру использовать прозрачные большие страницы
+struct HugePageAllocator {
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    void* allocate(size_t bytes) {
+        size_t length = roundUp(bytes);
+        void* block = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED) {
+            block = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (block == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            madvise(block, length, MADV_HUGEPAGE);
+        }
+        return block;
+    }
+
+    void deallocate(void* block, size_t bytes) { munmap(block, roundUp(bytes)); }
+
+private:
+    static size_t roundUp(size_t bytes) {
+        return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+};
+#else
+// Большие страницы поддержаны только для Linux
+using HugePageAllocator = CacheAlignedAllocator;
+#endif
+
+// Окна набора в памяти для BasicDataManager: CenterBuffer вместе с его емкостью
+
+// Окно емкостью MAX_SIZE, размещенное внутри объекта
+template <typename T, size_t MAX_SIZE>
+class InlineWindow : public CenterBuffer<T, InlineStorage<T, MAX_SIZE / 2 + 1>> {
+public:
+    size_t capacity() const { return MAX_SIZE; }
+};
+
+// Блок памяти распределителя под обе половины окна
+template <typename T, typename Allocator>
+class AllocatedBlock {
+protected:
+    Allocator allocator;
+    size_t half;         // Емкость каждой половины
+    T* block;            // Общий блок памяти для обеих половин
+
+    AllocatedBlock(size_t capacity, const Allocator& alloc)
+        : allocator(alloc), half(capacity / 2 + 1),
+        block(static_cast<T*>(allocator.allocate(2 * half * sizeof(T)))) {}
+
+    ~AllocatedBlock() { allocator.deallocate(block, 2 * half * sizeof(T)); }
+
+public:
+    AllocatedBlock(const AllocatedBlock&) = delete;
+    AllocatedBlock& operator=(const AllocatedBlock&) = delete;
+};
+
+// Окно с емкостью, заданной при создании, в блоке распределителя.
+// Блок - первый базовый класс, поэтому он выделяется до построения половин
+template <typename T, typename Allocator>
+class AllocatedWindow : private AllocatedBlock<T, Allocator>, public CenterBuffer<T, BlockStorage<T>> {
+    // Окно хранится в сырой памяти распределителя без вызова конструкторов
+    static_assert(std::is_trivially_default_constructible<T>::value,
+        "Окно в памяти распределителя поддерживает только тривиальные типы");
+
+private:
+    size_t limit;        // Емкость окна
+
+public:
+    AllocatedWindow(size_t capacity, const Allocator& alloc)
+        : AllocatedBlock<T, Allocator>(capacity, alloc),
+        CenterBuffer<T, BlockStorage<T>>(this->block, this->half), limit(capacity) {}
+
+    size_t capacity() const { return limit; }
+};
+
+// Общая основа DataManager и DynamicDataManager: набор с быстрым доступом к центральному
+// элементу, который при переполнении выгружается в файл блоками по емкости окна.
+// Window - окно набора в памяти (InlineWindow или AllocatedWindow),
+// Sanitizer - обработка добавляемых элементов (KeepElements или ReplacePunctuation),
+// Spill - способ хранения файла дампа (SpillFile, MappedSpillFile или AsyncSpillFile),
+// Codec - формат выгружаемых блоков (RawCodec, DeltaVarintCodec, XorFloatCodec, RunLengthCodec)
+template <typename T, typename Window, typename Sanitizer, typename Spill, typename Codec>
+class BasicDataManager {
+    // Элементы выгружаются в файл побайтовым копированием
+    static_assert(std::is_trivially_copyable<T>::value,
+        "DataManager поддерживает только тривиально копируемые типы");
+
+protected:
+    Window data;                       // Хранилище набора
+    DumpPath dumpPath;                 // Имя файла для выгрузки данных
+    Spill dump;                        // Файл дампа, открытый на все время жизни набора
+    std::vector<T> scratch;            // Буфер на одно окно для выгрузки, загрузки и обработки блоков
+    std::vector<char> encoded;         // Закодированные сегменты, еще не переданные в дамп
+    std::vector<size_t> segmentSizes;  // Размеры закодированных сегментов
+    size_t batchLimit;                 // Объем сегментов, передаваемых в дамп одной записью
+    size_t rawBytes = 0;               // Объем выгруженных данных до кодирования
+
+    // Окно строится из аргументов windowArgs
+    template <typename... WindowArgs>
+    BasicDataManager(const std::string& dumpFile, size_t spillBufferSize, WindowArgs&&... windowArgs)
+        : data(std::forward<WindowArgs>(windowArgs)...), dumpPath(dumpFile),
+        dump(dumpPath.str(), spillBufferSize), scratch(data.capacity()), batchLimit(spillBufferSize) {}
+
+    // Кодирование блока элементов в очередной сегмент дампа.
+    // Сегменты копятся до batchLimit байт и уходят в дамп одной записью
+    void appendSegment(const T* block, size_t count) {
+        size_t before = encoded.size();
+        Codec::encode(block, count, encoded);
+        segmentSizes.push_back(encoded.size() - before);
+        rawBytes += count * sizeof(T);
+        if (encoded.size() >= batchLimit) {
+            flushSegments();
         }
     }
 
-    // Возврат центрального символа
-    char peek() const {
-        if (current_size == 0) return '\0';
+    // Передача накопленных сегментов в дамп
+    void flushSegments() {
+        if (segmentSizes.empty()) return;
+        dump.pushSegments(encoded.data(), segmentSizes.data(), segmentSizes.size());
+        encoded.clear();
+        segmentSizes.clear();
+    }
+
+public:
+    // Добавление одного элемента в набор
+    void push(T elem) {
+        // Если набор заполнен - выгружаем данные в файл
+        if (data.size() >= data.capacity()) {
+            dumpToFile();
+        }
 
-        size_t center = getCenterIndex();
-        return data[center];
+        // Вставляем новый элемент в начало
+        data.pushFront(Sanitizer::apply(elem));
     }
 
-    // Извлечение центрального символа
-    char pop() {
-        if (current_size == 0) return '\0';
+    // Добавление группы элементов.
+    // Результат совпадает с n последовательными вызовами push(elem), но полные
+    // блоки по емкости окна сразу кодируются в дамп. Группа обрабатывается поблочно
+    // через буфер на одно окно, поэтому дополнительная память не зависит от n
+    void push(const T elems[], size_t n) {
+        size_t capacity = data.capacity();
+        T* block = scratch.data();
 
-        size_t center = getCenterIndex();
-        char elem = data[center];
+        // Заполняем свободное место в наборе
+        size_t i = std::min(n, capacity - data.size());
+        Sanitizer::apply(elems, i, block);
+        for (size_t k = 0; k < i; ++k) {
+            data.pushFront(block[k]);
+        }
+        if (i == n) return;
+
+        // Набор заполнен: при поэлементной вставке он выгружался бы перед каждым
+        // очередным полным блоком, а в памяти оставался бы только хвост
+        size_t rest = n - i;
+        size_t tail = (rest - 1) % capacity + 1;
 
-        // Смещение элементов
-        for (size_t i = center; i < current_size - 1; ++i) {
-            data[i] = data[i + 1];
+        data.copyTo(block);
+        appendSegment(block, capacity);
+        for (; n - i > tail; i += capacity) {
+            // Внутри набора элементы хранятся от последнего добавленного к первому
+            Sanitizer::apply(elems + i, capacity, block);
+            std::reverse(block, block + capacity);
+            appendSegment(block, capacity);
         }
+        flushSegments();
+
+        // Хвост остается в памяти
+        Sanitizer::apply(elems + i, tail, block);
+        std::reverse(block, block + tail);
+        data.assign(block, tail);
+    }
 
-        --current_size;
+    // Возврат центрального элемента без извлечения
+    T peek() const {
+        if (data.size() == 0) return T();
+        return data.center();
+    }
+
+    // Извлечение центрального элемента
+    T pop() {
+        if (data.size() == 0) return T();
 
-        // Загрузка из файла, если набор пуст
-        if (current_size == 0) {
+        T elem = data.popCenter();
+
+        // Если набор пуст, пробуем загрузить из файла дампа
+        if (data.size() == 0) {
             loadFromDumpFile();
         }
 
         return elem;
     }
 
+    // Выгрузка данных в файл при заполнении
+    void dumpToFile() {
+        // Собираем набор в непрерывный массив в логическом порядке
+        data.copyTo(scratch.data());
+        appendSegment(scratch.data(), data.size());
+        flushSegments();
+        data.clear();
+    }
+
+    // Загрузка данных из файла дампа - возвращается последний выгруженный блок,
+    // остальные блоки остаются в файле до следующих загрузок
+    void loadFromDumpFile() {
+        if (dump.segmentCount() > 0) {
+            encoded.resize(Codec::template maxEncodedSize<T>(data.capacity()));
+            size_t bytes = dump.popSegment(encoded.data(), encoded.size());
+            data.assign(scratch.data(), Codec::decode(encoded.data(), bytes, scratch.data()));
+            encoded.clear();
+        }
+    }
+
+    // Получение текущего размера набора
+    size_t size() const { return data.size(); }
+
+    // Наибольший размер набора в памяти
+    size_t maxSize() const { return data.capacity(); }
+
+    // Статистика выгрузки в файл
+    SpillStats spillStats() const {
+        SpillStats stats = dump.getStats();
+        stats.rawBytes = rawBytes;
+        return stats;
+    }
+};
+
+// Шаблонный класс DataManager для работы с однотипным набором данных.
+// Емкость MAX_SIZE задана при компиляции, окно набора размещается внутри объекта.
+// Spill - способ хранения файла дампа (SpillFile, MappedSpillFile или AsyncSpillFile),
+// Codec - формат выгружаемых блоков (RawCodec, DeltaVarintCodec, XorFloatCodec, RunLengthCodec)
+template <typename T, size_t MAX_SIZE = 64, typename Spill = SpillFile, typename Codec = RawCodec>
+class DataManager : public BasicDataManager<T, InlineWindow<T, MAX_SIZE>, KeepElements, Spill, Codec> {
+private:
+    typedef BasicDataManager<T, InlineWindow<T, MAX_SIZE>, KeepElements, Spill, Codec> Base;
+
+public:
+    // Конструктор - размер буфера выгрузки задает, как часто данные сбрасываются на диск.
+    // Каждый набор выгружается в собственный временный файл
+    explicit DataManager(size_t spillBufferSize = Spill::DEFAULT_BUFFER_SIZE)
+        : DataManager(std::string(), spillBufferSize) {}
+
+    // Конструктор с явным именем файла выгрузки
+    explicit DataManager(const std::string& dumpFile, size_t spillBufferSize = Spill::DEFAULT_BUFFER_SIZE)
+        : Base(dumpFile, spillBufferSize) {}
+};
+
+// Специализация для символьного типа: пунктуация заменяется на подчеркивание,
+// а извлекать символы можно с переводом регистра
+template <typename Spill, typename Codec>
+class DataManager<char, 64, Spill, Codec>
+    : public BasicDataManager<char, InlineWindow<char, 64>, ReplacePunctuation, Spill, Codec> {
+private:
+    typedef BasicDataManager<char, InlineWindow<char, 64>, ReplacePunctuation, Spill, Codec> Base;
+
+public:
+    // Конструктор с временным файлом выгрузки
+    explicit DataManager(size_t spillBufferSize = Spill::DEFAULT_BUFFER_SIZE)
+        : DataManager(std::string(), spillBufferSize) {}
+
+    // Конструктор с явным именем файла выгрузки
+    explicit DataManager(const std::string& dumpFile, size_t spillBufferSize = Spill::DEFAULT_BUFFER_SIZE)
+        : Base(dumpFile, spillBufferSize) {}
+
     // Извлечение и преобразование в верхний регистр
     char popUpper() {
-        char c = pop();
+        char c = this->pop();
         return std::toupper(static_cast<unsigned char>(c));
     }
 
     // Извлечение и преобразование в нижний регистр
     char popLower() {
-        char c = pop();
+        char c = this->pop();
         return std::tolower(static_cast<unsigned char>(c));
     }
 
-    // Выгрузка в файл
-    void dumpToFile() {
-        std::ofstream dump(DUMP_FILE, std::ios::app | std::ios::binary);
-        dump.write(data, current_size);
-        dump.close();
-        current_size = 0;
+    // Извлечение до n символов (пока набор не опустеет) в верхнем регистре
+    std::string popUpper(size_t n) {
+        std::string text = popSpan(n);
+        CharSpan::toUpper(&text[0], text.size());
+        return text;
     }
 
-    // Загрузка из файла
-    void loadFromDumpFile() {
-        std::ifstream dump(DUMP_FILE, std::ios::binary);
-        if (dump) {
-            dump.seekg(0, std::ios::end);
-            size_t file_size = dump.tellg();
-
-            if (file_size > 0) {
-                dump.seekg(0, std::ios::beg);
-                size_t read_size = std::min(file_size, static_cast<size_t>(64));
-                dump.read(data, read_size);
-                current_size = read_size;
-
-                // Очистка файла после чтения
-                dump.close();
-                std::ofstream truncate(DUMP_FILE, std::ios::trunc);
-                truncate.close();
+    // Извлечение до n символов (пока набор не опустеет) в нижнем регистре
+    std::string popLower(size_t n) {
+        std::string text = popSpan(n);
+        CharSpan::toLower(&text[0], text.size());
+        return text;
+    }
+
+    // Извлечение до n символов в порядке извлечения
+    std::string popSpan(size_t n) {
+        std::string text;
+        text.reserve(std::min(n, this->size()));
+        while (text.size() < n && this->size() > 0) {
+            text.push_back(this->pop());
+        }
+        return text;
+    }
+};
+
+// Вариант DataManager с емкостью, задаваемой в конструкторе.
+// Окно набора размещается распределителем Allocator (CacheAlignedAllocator или HugePageAllocator),
+// а обработка добавляемых элементов задается политикой Sanitizer (KeepElements или
+// ReplacePunctuation - аналог DataManager<char> для любой емкости)
+template <typename T, typename Sanitizer = KeepElements, typename Allocator = CacheAlignedAllocator,
+    typename Spill = SpillFile, typename Codec = RawCodec>
+class DynamicDataManager
+    : public BasicDataManager<T, AllocatedWindow<T, Allocator>, Sanitizer, Spill, Codec> {
+private:
+    typedef BasicDataManager<T, AllocatedWindow<T, Allocator>, Sanitizer, Spill, Codec> Base;
+
+public:
+    explicit DynamicDataManager(size_t maxSize, const std::string& dumpFile = std::string(),
+        size_t spillBufferSize = Spill::DEFAULT_BUFFER_SIZE, const Allocator& allocator = Allocator())
+        : Base(dumpFile, spillBufferSize, std::max<size_t>(maxSize, 1), allocator) {}
+};
+
+// Потокобезопасный набор для нескольких производителей и потребителей.
+// Данные распределены по независимым сегментам со своими блокировками и файлами выгрузки:
+// поток добавляет элементы в "свой" сегмент, а при извлечении сначала обращается к нему,
+// затем к остальным. Центральный элемент определяется в пределах сегмента
+template <typename T, size_t MAX_SIZE = 64, typename Spill = SpillFile, typename Codec = RawCodec>
+class ConcurrentDataManager {
+private:
+    struct Shard {
+        std::mutex lock;
+        DataManager<T, MAX_SIZE, Spill, Codec> manager;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    // Сегмент, закрепленный за текущим потоком
+    size_t homeShard() const {
+        return std::hash<std::thread::id>()(std::this_thread::get_id()) % shards.size();
+    }
+
+public:
+    // По умолчанию - по одному сегменту на аппаратный поток
+    explicit ConcurrentDataManager(size_t shardCount = std::thread::hardware_concurrency()) {
+        shardCount = std::max<size_t>(shardCount, 1);
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.emplace_back(new Shard());
+        }
+    }
+
+    // Добавление одного элемента
+    void push(T elem) {
+        Shard& shard = *shards[homeShard()];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.manager.push(elem);
+    }
+
+    // Добавление группы элементов
+    void push(T elems[], size_t n) {
+        Shard& shard = *shards[homeShard()];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.manager.push(elems, n);
+    }
+
+    // Извлечение центрального элемента одного из сегментов, false - если набор пуст
+    bool tryPop(T& elem) {
+        size_t home = homeShard();
+        for (size_t i = 0; i < shards.size(); ++i) {
+            Shard& shard = *shards[(home + i) % shards.size()];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if (shard.manager.size() > 0) {
+                elem = shard.manager.pop();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Количество элементов в памяти (без учета выгруженных)
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard->lock);
+            total += shard->manager.size();
+        }
+        return total;
+    }
+};
+
+// Самопроверки (запуск с ключом --selftest)
+
+// Векторные функции CharSpan против посимвольных вариантов на случайных байтах.
+// Длины и смещения не кратны ширине вектора, чтобы проверить и остаток
+bool checkCharSpan() {
+    std::mt19937 random(9);
+    for (int round = 0; round < 20000; ++round) {
+        size_t offset = random() % 32;
+        size_t n = random() % 300;
+        std::vector<char> text(offset + n);
+        for (char& c : text) {
+            // Только ASCII, ASCII с редкими байтами >= 0x80 или произвольные байты
+            unsigned kind = round % 3;
+            unsigned value = kind == 0 ? random() % 0x80
+                : kind == 1 ? (random() % 64 == 0 ? 0x80 + random() % 0x80 : random() % 0x80)
+                : random() % 0x100;
+            c = static_cast<char>(value);
+        }
+        const char* in = text.data() + offset;
+
+        std::vector<char> fast(text.size()), slow(text.size());
+        CharSpan::sanitize(in, n, fast.data() + offset);
+        CharSpan::sanitizeScalar(in, n, slow.data() + offset);
+        bool ok = fast == slow;
+
+        fast = text;
+        slow = text;
+        CharSpan::toUpper(fast.data() + offset, n);
+        CharSpan::toUpperScalar(slow.data() + offset, n);
+        ok = ok && fast == slow;
+
+        fast = text;
+        slow = text;
+        CharSpan::toLower(fast.data() + offset, n);
+        CharSpan::toLowerScalar(slow.data() + offset, n);
+        ok = ok && fast == slow;
+
+        if (!ok) {
+            std::cout << "CharSpan: расхождение со скалярным вариантом, длина " << n
+                << ", смещение " << offset << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Все самопроверки режима --selftest, true - если все пройдены
+bool runSelfTests() {
+    bool charSpan = checkCharSpan();
+    std::cout << "CharSpan (векторный и скалярный пути): " << (charSpan ? "пройдено" : "ошибка") << std::endl;
+    return charSpan;
+}
+
+// Замеры производительности (запуск с ключом --bench)
+
+// Результаты замеров, чтобы компилятор не удалил вычисления
+volatile long long benchSink = 0;
+
+// Время выполнения действия в наносекундах
+template <typename Action>
+double elapsedNs(Action action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Прежняя раскладка набора: массив, который сдвигается при вставке в начало
+// и при извлечении центра. Используется только для сравнения с CenterBuffer
+template <typename T, size_t MAX_SIZE>
+class ShiftBuffer {
+private:
+    T items[MAX_SIZE];
+    size_t count = 0;
+
+public:
+    void pushFront(const T& elem) {
+        for (size_t i = count; i > 0; --i) {
+            items[i] = items[i - 1];
+        }
+        items[0] = elem;
+        ++count;
+    }
+
+    T popCenter() {
+        size_t center = count % 2 == 0 ? count / 2 - 1 : count / 2;
+        T elem = items[center];
+        for (size_t i = center; i + 1 < count; ++i) {
+            items[i] = items[i + 1];
+        }
+        --count;
+        return elem;
+    }
+
+    size_t size() const { return count; }
+};
+
+// Набор заполняется до емкости и опустошается извлечением центра, результат - нс на операцию
+template <typename Buffer>
+double fillAndDrainNs(Buffer& buffer, size_t capacity, size_t rounds) {
+    long long sum = 0;
+    double ns = elapsedNs([&] {
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < capacity; ++i) {
+                buffer.pushFront(static_cast<int>(i + r));
+            }
+            while (buffer.size() > 0) {
+                sum += buffer.popCenter();
             }
         }
+    });
+    benchSink = benchSink + sum;
+    return ns / (2.0 * capacity * rounds);
+}
+
+// Сравнение раскладок для набора емкостью MAX_SIZE
+template <size_t MAX_SIZE>
+void benchLayout(size_t rounds) {
+    std::unique_ptr<ShiftBuffer<int, MAX_SIZE>> shift(new ShiftBuffer<int, MAX_SIZE>());
+    std::unique_ptr<InlineWindow<int, MAX_SIZE>> ring(new InlineWindow<int, MAX_SIZE>());
+    double shiftNs = fillAndDrainNs(*shift, MAX_SIZE, rounds);
+    double ringNs = fillAndDrainNs(*ring, MAX_SIZE, rounds);
+    std::cout << "  емкость " << std::setw(6) << MAX_SIZE << ": сдвиг " << std::setw(8) << shiftNs
+        << " нс, кольцо " << std::setw(6) << ringNs << " нс, ускорение x" << shiftNs / ringNs << std::endl;
+}
+
+// Прежняя раскладка со сдвигом против кольцевых половин CenterBuffer
+void benchmarkLayout() {
+    std::cout << "Раскладка набора (вставка в начало и извлечение центра, нс на операцию):" << std::endl;
+    benchLayout<64>(200000);
+    benchLayout<1024>(2000);
+    benchLayout<16384>(10);
+}
+
+// Значение процентиля q (от 0 до 1) в выборке, порядок выборки меняется
+double percentile(std::vector<double>& samples, double q) {
+    size_t k = std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+// Задержка отдельных вызовов push для набора с выгрузкой Spill.
+// Буфер выгрузки отключен, поэтому каждое переполнение набора обращается к файлу
+template <typename Spill>
+void benchPushLatency(const char* name, size_t count) {
+    std::vector<double> latency(count);
+    {
+        DataManager<int, 64, Spill> manager(static_cast<size_t>(0));
+        for (size_t i = 0; i < count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            manager.push(static_cast<int>(i));
+            latency[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
     }
+    std::cout << "  " << std::left << std::setw(32) << name << std::right
+        << " p50 " << std::setw(8) << percentile(latency, 0.50)
+        << " нс, p99 " << std::setw(9) << percentile(latency, 0.99)
+        << " нс, p99.9 " << std::setw(9) << percentile(latency, 0.999) << " нс" << std::endl;
+}
+
+// Синхронная выгрузка против асинхронной
+void benchmarkSpillLatency() {
+    const size_t count = 1000000;
+    std::cout << "\nЗадержка push при выгрузке каждые 64 элемента:" << std::endl;
+    benchPushLatency<SpillFile>("SpillFile", count);
+    benchPushLatency<AsyncSpillFile<SpillFile>>("AsyncSpillFile<SpillFile>", count);
+    benchPushLatency<MappedSpillFile>("MappedSpillFile", count);
+    benchPushLatency<AsyncSpillFile<MappedSpillFile>>("AsyncSpillFile<MappedSpillFile>", count);
+}
+
+// Один DataManager под общей блокировкой - для сравнения с ConcurrentDataManager
+struct LockedDataManager {
+    std::mutex lock;
+    DataManager<int> manager;
 
-    // Получение текущего размера
-    size_t size() const { return current_size; }
+    void push(int elem) {
+        std::lock_guard<std::mutex> guard(lock);
+        manager.push(elem);
+    }
+
+    bool tryPop(int& elem) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (manager.size() == 0) return false;
+        elem = manager.pop();
+        return true;
+    }
 };
 
-int main() {
+// Пропускная способность набора при threads потоках, млн операций в секунду.
+// Каждый поток добавляет элементы и извлекает каждый второй
+template <typename Set>
+double threadedMops(Set& set, size_t threads, size_t opsPerThread) {
+    std::vector<std::thread> workers;
+    double ns = elapsedNs([&] {
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&set, opsPerThread] {
+                long long sum = 0;
+                for (size_t i = 0; i < opsPerThread; ++i) {
+                    set.push(static_cast<int>(i));
+                    int elem = 0;
+                    if (i % 2 == 1 && set.tryPop(elem)) {
+                        sum += elem;
+                    }
+                }
+                benchSink = benchSink + sum;
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+    return 1.5 * opsPerThread * threads / ns * 1000.0;
+}
+
+// Масштабирование ConcurrentDataManager по числу потоков
+void benchmarkConcurrency() {
+    const size_t opsPerThread = 400000;
+    size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+    std::cout << "\nДобавление и извлечение из нескольких потоков, млн операций/с"
+        << " (аппаратных потоков: " << std::thread::hardware_concurrency() << "):" << std::endl;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        LockedDataManager locked;
+        ConcurrentDataManager<int> concurrent;
+        double lockedMops = threadedMops(locked, threads, opsPerThread);
+        double concurrentMops = threadedMops(concurrent, threads, opsPerThread);
+        std::cout << "  потоков " << std::setw(3) << threads << ": общая блокировка " << std::setw(7) << lockedMops
+            << ", ConcurrentDataManager " << std::setw(7) << concurrentMops << std::endl;
+    }
+}
+
+// Степень сжатия и скорость выгрузки и загрузки набора с кодеком Codec
+template <typename T, typename Codec>
+void benchCodec(const char* name, const std::vector<T>& input) {
+    DataManager<T, 64, SpillFile, Codec> manager;
+    double pushNs = elapsedNs([&] { manager.push(input.data(), input.size()); });
+    SpillStats stats = manager.spillStats();
+    long long sum = 0;
+    double popNs = elapsedNs([&] {
+        while (manager.size() > 0) {
+            sum += static_cast<long long>(manager.pop());
+        }
+    });
+    benchSink = benchSink + sum;
+
+    double bytes = static_cast<double>(input.size() * sizeof(T));
+    std::cout << "  " << std::left << std::setw(34) << name << std::right
+        << " сжатие x" << std::setw(6) << static_cast<double>(stats.rawBytes) / stats.bytesSpilled
+        << ", добавление " << std::setw(7) << bytes / pushNs * 1000.0
+        << " МБ/с, извлечение " << std::setw(7) << bytes / popNs * 1000.0 << " МБ/с" << std::endl;
+}
+
+// Кодеки выгрузки на типичных данных: монотонные счетчики, медленно меняющиеся
+// показания датчика и символьные серии
+void benchmarkCodecs() {
+    const size_t count = 4000000;
+    std::mt19937 random(42);
+
+    std::vector<int> counters(count);
+    int counter = 1000000;
+    for (int& value : counters) {
+        counter += static_cast<int>(random() % 8);
+        value = counter;
+    }
+
+    std::vector<double> readings(count);
+    for (size_t i = 0; i < count; ++i) {
+        readings[i] = 20.0 + 0.25 * static_cast<double>(i / 16 % 40);
+    }
+
+    std::vector<char> runs;
+    while (runs.size() < count) {
+        runs.insert(runs.end(), 1 + random() % 40, static_cast<char>('a' + random() % 26));
+    }
+    runs.resize(count);
+
+    std::cout << "\nКодеки выгрузки (" << count << " элементов):" << std::endl;
+    benchCodec<int, RawCodec>("int, RawCodec", counters);
+    benchCodec<int, DeltaVarintCodec>("int, DeltaVarintCodec", counters);
+    benchCodec<double, RawCodec>("double, RawCodec", readings);
+    benchCodec<double, XorFloatCodec>("double, XorFloatCodec", readings);
+    benchCodec<char, RawCodec>("char, RawCodec", runs);
+    benchCodec<char, RunLengthCodec>("char, RunLengthCodec", runs);
+}
+
+// Все замеры режима --bench
+void runBenchmarks() {
+    std::cout << std::fixed << std::setprecision(2);
+    benchmarkLayout();
+    benchmarkSpillLatency();
+    benchmarkConcurrency();
+    benchmarkCodecs();
+}
+
+int main(int argc, char* argv[]) {
     // Установка русской локали для корректного вывода
     setlocale(LC_ALL, "Russian");
 
+    // Самопроверки или замеры производительности вместо демонстрации
+    if (argc > 1 && std::string(argv[1]) == "--selftest") {
+        return runSelfTests() ? 0 : 1;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmarks();
+        return 0;
+    }
+
     // Демонстрация работы с целыми числами
     {
         std::cout << "Демонстрация DataManager для целых чисел:" << std::endl;
@@ -5,123 +5,2310 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <iomanip>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+// Векторные ядра поиска границ слов; нужный набор инструкций выбирается во время выполнения
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WORD_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define WORD_SCANNER_TARGET(isa)
+#else
+#define WORD_SCANNER_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
 
 
+// Хранилище строк: строки копируются в крупные блоки памяти и живут,
+// пока жив пул, поэтому на каждое новое слово не требуется отдельное выделение памяти
+class StringPool {
+private:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> chunks;  // Выделенные блоки
+    char* cursor = nullptr;                       // Свободное место в текущем блоке
+    size_t left = 0;                              // Сколько байт осталось в текущем блоке
+    size_t reserved = 0;                          // Сколько байт выделено всего
+
+public:
+    // Копирование строки в пул, возвращает постоянный указатель на копию
+    const char* intern(const char* text, size_t length) {
+        if (length > left) {
+            size_t size = length > CHUNK_SIZE ? length : CHUNK_SIZE;
+            chunks.emplace_back(new char[size]);
+            cursor = chunks.back().get();
+            left = size;
+            reserved += size;
+        }
+        char* stored = cursor;
+        std::memcpy(stored, text, length);
+        cursor += length;
+        left -= length;
+        return stored;
+    }
+
+    // Перенос блоков другого пула: строки остаются на месте, и указатели на них
+    // действительны, пока жив этот пул
+    void adopt(StringPool& other) {
+        for (std::unique_ptr<char[]>& chunk : other.chunks) {
+            chunks.push_back(std::move(chunk));
+        }
+        reserved += other.reserved;
+        other.chunks.clear();
+        other.cursor = nullptr;
+        other.left = 0;
+        other.reserved = 0;
+    }
+
+    // Объем выделенной памяти в байтах
+    size_t memoryUsage() const { return reserved; }
+};
+
+// Алфавитный порядок слов: побайтовое сравнение байтов без знака, как у memcmp.
+// Общий для выборок, n-грамм и снимков, поэтому слова вне ASCII (UTF-8) везде идут после ASCII
+inline bool wordLess(const char* a, size_t aLength, const char* b, size_t bLength) {
+    int order = std::memcmp(a, b, std::min(aLength, bLength));
+    return order < 0 || (order == 0 && aLength < bLength);
+}
+
+// Хеш-таблица с открытой адресацией "слово -> количество".
+// Ключи - указатели на строки в пуле, поэтому подсчет уже известного слова
+// стоит одного вычисления хеша и обходится без выделения памяти
+class WordTable {
+public:
+    // Ячейка таблицы
+    struct Entry {
+        const char* word = nullptr;   // Слово в пуле строк (nullptr - пустая ячейка)
+        uint32_t length = 0;          // Длина слова
+        uint32_t hash = 0;            // Сохраненный хеш для быстрого сравнения и перестроения
+        int count = 0;                // Количество повторений
+    };
+
+private:
+    std::vector<Entry> slots;   // Ячейки, количество - степень двойки
+    size_t used = 0;            // Количество занятых ячеек
+    StringPool pool;            // Хранилище самих слов
+
+    // Хеш FNV-1a
+    static uint32_t hashOf(const char* text, size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(text[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Увеличение таблицы вдвое с переносом занятых ячеек
+    void grow() {
+        std::vector<Entry> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Entry& entry : old) {
+            if (entry.word == nullptr) continue;
+            size_t pos = entry.hash & mask;
+            while (slots[pos].word != nullptr) {
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = entry;
+        }
+    }
+
+    // Ячейка слова с известным хешем. Новое слово копируется в пул; при copy = false
+    // сохраняется сам указатель text (строка уже лежит в пуле этой таблицы)
+    Entry& lookup(const char* text, size_t length, uint32_t hash, bool copy = true) {
+        // Заполнение не более 3/4, чтобы цепочки проб оставались короткими
+        if ((used + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+
+        size_t mask = slots.size() - 1;
+        size_t pos = hash & mask;
+        while (slots[pos].word != nullptr) {
+            Entry& entry = slots[pos];
+            if (entry.hash == hash && entry.length == length && std::memcmp(entry.word, text, length) == 0) {
+                return entry;
+            }
+            pos = (pos + 1) & mask;
+        }
+
+        Entry& entry = slots[pos];
+        entry.word = copy ? pool.intern(text, length) : text;
+        entry.length = static_cast<uint32_t>(length);
+        entry.hash = hash;
+        ++used;
+        return entry;
+    }
+
+public:
+    WordTable() : slots(1024) {}
+
+    // Счетчик слова; новое слово копируется в пул и получает нулевой счетчик
+    int& operator()(const char* text, size_t length) {
+        return lookup(text, length, hashOf(text, length)).count;
+    }
+
+    // Ячейка слова; новое слово добавляется с нулевым счетчиком.
+    // Ссылка действительна до следующего добавления, указатель на слово - пока жива таблица
+    Entry& entry(const char* text, size_t length) {
+        return lookup(text, length, hashOf(text, length));
+    }
+
+    // Добавление счетчика из другой таблицы без повторного вычисления хеша
+    void add(const Entry& other) {
+        lookup(other.word, other.length, other.hash).count += other.count;
+    }
+
+    // Слияние таблиц в threadCount потоков; исходные таблицы опустошаются.
+    // Результат сразу получает нужный размер, и ячейки делятся на диапазоны по номеру
+    // начальной ячейки слова. Каждый поток раскладывает свои исходные таблицы по диапазонам
+    // за один проход, затем каждый поток заполняет свой диапазон. Слово, цепочка проб
+    // которого доходит до конца диапазона, добавляется после этого обычным поиском.
+    // Слова не копируются: пулы строк исходных таблиц переходят в результат
+    static WordTable merge(std::vector<WordTable>& sources, size_t threadCount) {
+        size_t total = 0;
+        for (const WordTable& source : sources) {
+            total += source.used;
+        }
+        WordTable result;
+        size_t slotCount = result.slots.size();
+        while ((total + 1) * 4 > slotCount * 3) {
+            slotCount *= 2;
+        }
+        result.slots.assign(slotCount, Entry());
+        size_t mask = slotCount - 1;
+
+        size_t partCount = 1;
+        while (partCount < threadCount && slotCount / (partCount * 2) >= 256) {
+            partCount *= 2;
+        }
+        size_t partSize = slotCount / partCount;
+
+        // Выполнение job(0..count-1) в threadCount потоках
+        auto parallel = [threadCount](size_t count, const std::function<void(size_t)>& job) {
+            std::atomic<size_t> next(0);
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < std::min(threadCount, count); ++t) {
+                workers.emplace_back([&] {
+                    for (size_t i = next++; i < count; i = next++) {
+                        job(i);
+                    }
+                });
+            }
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        };
+
+        std::vector<std::vector<std::vector<const Entry*>>> parts(sources.size(),
+            std::vector<std::vector<const Entry*>>(partCount));
+        parallel(sources.size(), [&](size_t i) {
+            sources[i].forEach([&](const Entry& entry) {
+                parts[i][(entry.hash & mask) / partSize].push_back(&entry);
+            });
+        });
+
+        std::vector<std::vector<const Entry*>> overflow(partCount);
+        std::vector<size_t> placed(partCount, 0);
+        parallel(partCount, [&](size_t p) {
+            size_t end = (p + 1) * partSize;
+            for (const std::vector<std::vector<const Entry*>>& source : parts) {
+                for (const Entry* entry : source[p]) {
+                    size_t pos = entry->hash & mask;
+                    while (pos < end && result.slots[pos].word != nullptr) {
+                        Entry& slot = result.slots[pos];
+                        if (slot.hash == entry->hash && slot.length == entry->length
+                            && std::memcmp(slot.word, entry->word, entry->length) == 0) {
+                            break;
+                        }
+                        ++pos;
+                    }
+                    if (pos == end) {
+                        overflow[p].push_back(entry);
+                    }
+                    else if (result.slots[pos].word != nullptr) {
+                        result.slots[pos].count += entry->count;
+                    }
+                    else {
+                        result.slots[pos] = *entry;
+                        ++placed[p];
+                    }
+                }
+            }
+        });
+
+        for (size_t p = 0; p < partCount; ++p) {
+            result.used += placed[p];
+        }
+        for (const std::vector<const Entry*>& entries : overflow) {
+            for (const Entry* entry : entries) {
+                result.lookup(entry->word, entry->length, entry->hash, false).count += entry->count;
+            }
+        }
+        for (WordTable& source : sources) {
+            result.pool.adopt(source.pool);
+            source.slots.assign(1024, Entry());
+            source.used = 0;
+        }
+        return result;
+    }
+
+    // Обход всех слов таблицы
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (const Entry& entry : slots) {
+            if (entry.word != nullptr) {
+                visit(entry);
+            }
+        }
+    }
+
+    // Количество различных слов
+    size_t size() const { return used; }
+
+    // Объем памяти под ячейки и слова в байтах
+    size_t memoryUsage() const { return slots.capacity() * sizeof(Entry) + pool.memoryUsage(); }
+};
+
+// Приближенный подсчет слов в памяти фиксированного размера для словарей без ограничения.
+// Частоты оцениваются скетчем Count-Min (с консервативным обновлением): оценка не меньше
+// истинной частоты и с вероятностью 1 - delta превышает ее не более чем на epsilon * (число слов).
+// Самые частые слова хранятся в таблице из heavyHitters ячеек: новое слово вытесняет слово
+// с наименьшей оценкой, если его собственная оценка больше (как в алгоритме Space-Saving)
+class WordSketch {
+public:
+    // Параметры точности и объема памяти
+    struct Limits {
+        double epsilon;         // Допустимая ошибка как доля от общего числа слов
+        double delta;           // Вероятность превысить допустимую ошибку
+        size_t heavyHitters;    // Сколько самых частых слов хранить
+        size_t maxWordLength;   // Более длинные слова только учитываются в скетче
+
+        explicit Limits(double epsilon = 1e-4, double delta = 1e-3,
+            size_t heavyHitters = 1024, size_t maxWordLength = 32)
+            : epsilon(epsilon), delta(delta), heavyHitters(heavyHitters), maxWordLength(maxWordLength) {
+        }
+    };
+
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+    Limits limits;
+    size_t width;                      // Ширина строки скетча, степень двойки
+    size_t depth;                      // Количество строк скетча
+    std::vector<uint32_t> counters;    // Счетчики скетча, depth строк по width
+
+    std::vector<WordTable::Entry> hitters;   // Отслеживаемые слова
+    std::vector<char> words;                 // Место под слова, maxWordLength байт на ячейку
+    std::vector<uint32_t> heap;              // Номера ячеек, куча по возрастанию частоты
+    std::vector<uint32_t> heapPos;           // Позиция ячейки в куче
+    std::vector<uint32_t> index;             // Открытая адресация "хеш слова -> номер ячейки"
+    size_t used = 0;
+    uint64_t total = 0;
+
+    // Хеш FNV-1a (64 бита): младшая половина задает позицию в индексе,
+    // обе половины - позиции в строках скетча
+    static uint64_t hashOf(const char* text, size_t length) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(text[i])) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static size_t roundUpPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    uint32_t* cell(size_t row, uint64_t hash) {
+        uint32_t step = static_cast<uint32_t>(hash >> 32) | 1;
+        return &counters[row * width + ((static_cast<uint32_t>(hash) + row * step) & (width - 1))];
+    }
+
+    // Позиция слова в индексе либо пустая позиция для его вставки
+    size_t probe(uint32_t hash, const char* word, size_t length) const {
+        size_t mask = index.size() - 1;
+        size_t pos = hash & mask;
+        while (index[pos] != EMPTY) {
+            const WordTable::Entry& entry = hitters[index[pos]];
+            if (entry.hash == hash && entry.length == length && std::memcmp(entry.word, word, length) == 0) {
+                break;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    // Удаление из индекса со сдвигом следующих записей цепочки на освободившееся место
+    void erase(size_t pos) {
+        size_t mask = index.size() - 1;
+        index[pos] = EMPTY;
+        for (size_t next = (pos + 1) & mask; index[next] != EMPTY; next = (next + 1) & mask) {
+            size_t home = hitters[index[next]].hash & mask;
+            if (((next - home) & mask) >= ((next - pos) & mask)) {
+                index[pos] = index[next];
+                index[next] = EMPTY;
+                pos = next;
+            }
+        }
+    }
+
+    void swapHeap(size_t a, size_t b) {
+        std::swap(heap[a], heap[b]);
+        heapPos[heap[a]] = static_cast<uint32_t>(a);
+        heapPos[heap[b]] = static_cast<uint32_t>(b);
+    }
+
+    void siftUp(size_t pos) {
+        while (pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if (hitters[heap[parent]].count <= hitters[heap[pos]].count) break;
+            swapHeap(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void siftDown(size_t pos) {
+        for (;;) {
+            size_t smallest = pos;
+            size_t left = 2 * pos + 1;
+            size_t right = left + 1;
+            if (left < used && hitters[heap[left]].count < hitters[heap[smallest]].count) smallest = left;
+            if (right < used && hitters[heap[right]].count < hitters[heap[smallest]].count) smallest = right;
+            if (smallest == pos) break;
+            swapHeap(pos, smallest);
+            pos = smallest;
+        }
+    }
+
+    // Запись слова в ячейку slot
+    void store(uint32_t slot, const char* word, size_t length, uint32_t hash) {
+        char* place = &words[slot * limits.maxWordLength];
+        std::memcpy(place, word, length);
+        WordTable::Entry& entry = hitters[slot];
+        entry.word = place;
+        entry.length = static_cast<uint32_t>(length);
+        entry.hash = hash;
+    }
+
+    // Проверка параметров до вычисления размеров скетча: при epsilon <= 0 или delta вне (0, 1)
+    // ширина или глубина получились бы бесконечными или NaN
+    static const Limits& checked(const Limits& limits) {
+        if (!(limits.epsilon > 0.0 && limits.epsilon < 1.0)) {
+            throw std::invalid_argument("Допустимая ошибка epsilon должна быть в интервале (0, 1)");
+        }
+        if (!(limits.delta > 0.0 && limits.delta < 1.0)) {
+            throw std::invalid_argument("Вероятность delta должна быть в интервале (0, 1)");
+        }
+        if (limits.heavyHitters == 0 || limits.maxWordLength == 0) {
+            throw std::invalid_argument("Количество и длина хранимых слов должны быть больше нуля");
+        }
+        return limits;
+    }
+
+public:
+    // Вся память выделяется здесь и при подсчете больше не растет
+    explicit WordSketch(const Limits& limits = Limits())
+        : limits(checked(limits)),
+        width(roundUpPowerOfTwo(static_cast<size_t>(std::ceil(std::exp(1.0) / limits.epsilon)))),
+        depth(std::max<size_t>(1, static_cast<size_t>(std::ceil(std::log(1.0 / limits.delta))))),
+        counters(width * depth, 0),
+        hitters(limits.heavyHitters),
+        words(limits.heavyHitters * limits.maxWordLength),
+        heap(limits.heavyHitters),
+        heapPos(limits.heavyHitters),
+        index(roundUpPowerOfTwo(limits.heavyHitters * 2), EMPTY) {
+    }
+
+    // Учет одного вхождения слова
+    void add(const char* word, size_t length) {
+        ++total;
+        uint64_t hash = hashOf(word, length);
+
+        // Консервативное обновление: увеличиваются только минимальные счетчики
+        uint32_t estimate = 0xFFFFFFFFu;
+        for (size_t row = 0; row < depth; ++row) {
+            estimate = std::min(estimate, *cell(row, hash));
+        }
+        if (estimate != 0xFFFFFFFFu) ++estimate;
+        for (size_t row = 0; row < depth; ++row) {
+            uint32_t* counter = cell(row, hash);
+            *counter = std::max(*counter, estimate);
+        }
+
+        if (length > limits.maxWordLength || hitters.empty()) {
+            return;
+        }
+        int count = static_cast<int>(std::min<uint32_t>(estimate, INT32_MAX));
+        uint32_t key = static_cast<uint32_t>(hash);
+        size_t pos = probe(key, word, length);
+        if (index[pos] != EMPTY) {
+            // Частота отслеживаемого слова только растет, поэтому оно опускается в куче
+            uint32_t slot = index[pos];
+            hitters[slot].count = count;
+            siftDown(heapPos[slot]);
+            return;
+        }
+
+        if (used < hitters.size()) {
+            uint32_t slot = static_cast<uint32_t>(used++);
+            store(slot, word, length, key);
+            hitters[slot].count = count;
+            index[pos] = slot;
+            heap[slot] = slot;
+            heapPos[slot] = slot;
+            siftUp(slot);
+            return;
+        }
+
+        // Вытеснение слова с наименьшей оценкой
+        uint32_t slot = heap[0];
+        WordTable::Entry& weakest = hitters[slot];
+        if (count <= weakest.count) {
+            return;
+        }
+        erase(probe(weakest.hash, weakest.word, weakest.length));
+        store(slot, word, length, key);
+        weakest.count = count;
+        index[probe(key, word, length)] = slot;
+        siftDown(0);
+    }
+
+    // Оценка частоты слова сверху
+    uint32_t estimate(const char* word, size_t length) const {
+        uint64_t hash = hashOf(word, length);
+        uint32_t result = 0xFFFFFFFFu;
+        for (size_t row = 0; row < depth; ++row) {
+            result = std::min(result, *const_cast<WordSketch*>(this)->cell(row, hash));
+        }
+        return result;
+    }
+
+    // Обход отслеживаемых частых слов
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (size_t i = 0; i < used; ++i) {
+            visit(hitters[i]);
+        }
+    }
+
+    // Количество учтенных слов
+    uint64_t totalWords() const { return total; }
+
+    // Граница ошибки оценки при текущем числе слов
+    uint64_t errorBound() const { return static_cast<uint64_t>(std::ceil(limits.epsilon * total)); }
+
+    // Объем памяти в байтах (постоянный)
+    size_t memoryUsage() const {
+        return counters.size() * sizeof(uint32_t) + hitters.size() * sizeof(WordTable::Entry)
+            + words.size() + (heap.size() + heapPos.size() + index.size()) * sizeof(uint32_t);
+    }
+};
+
+const uint32_t WordSketch::EMPTY;
+
+// Подсчет n-грамм - последовательностей из n идущих подряд слов (n от 2 до 4).
+// Слова получают номера в словаре, n-грамма хранится как упакованный набор номеров
+// (16 байт ключа на любую n-грамму), поэтому строки при подсчете не склеиваются
+class NGramTable {
+public:
+    static const size_t MAX_LENGTH = 4;
+
+    // Ячейка таблицы: номера слов по 32 бита, упакованные в два 64-битных слова
+    struct Entry {
+        uint64_t key[2] = { 0, 0 };
+        int count = 0;               // Количество повторений (0 - пустая ячейка)
+    };
+
+private:
+    size_t n;
+    WordTable vocabulary;                  // Слово -> номер (хранится в поле count), с 1
+    std::vector<const char*> words;        // Номер - 1 -> слово в пуле словаря
+    std::vector<uint32_t> lengths;         // Номер - 1 -> длина слова
+    uint32_t window[MAX_LENGTH];           // Номера последних слов
+    size_t filled = 0;                     // Сколько слов в окне
+
+    std::vector<Entry> slots;              // Открытая адресация, количество - степень двойки
+    size_t used = 0;
+
+    static uint64_t hashOf(const uint64_t key[2]) {
+        uint64_t hash = key[0] * 0x9E3779B97F4A7C15ull ^ key[1];
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    void grow() {
+        std::vector<Entry> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Entry& entry : old) {
+            if (entry.count == 0) continue;
+            size_t pos = hashOf(entry.key) & mask;
+            while (slots[pos].count != 0) {
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = entry;
+        }
+    }
+
+    // Учет n-граммы из номеров в окне
+    void countWindow() {
+        uint64_t key[2] = { 0, 0 };
+        for (size_t i = 0; i < n; ++i) {
+            key[i / 2] |= static_cast<uint64_t>(window[i]) << (i % 2 == 0 ? 32 : 0);
+        }
+        if ((used + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        size_t mask = slots.size() - 1;
+        size_t pos = hashOf(key) & mask;
+        while (slots[pos].count != 0) {
+            if (slots[pos].key[0] == key[0] && slots[pos].key[1] == key[1]) {
+                ++slots[pos].count;
+                return;
+            }
+            pos = (pos + 1) & mask;
+        }
+        slots[pos].key[0] = key[0];
+        slots[pos].key[1] = key[1];
+        slots[pos].count = 1;
+        ++used;
+    }
+
+public:
+    explicit NGramTable(size_t n) : n(n), slots(1024) {
+        if (n < 2 || n > MAX_LENGTH) {
+            throw std::invalid_argument("Длина n-граммы должна быть от 2 до 4");
+        }
+    }
+
+    // Учет очередного слова: добавляет n-грамму из него и n - 1 предыдущих слов
+    void add(const char* word, size_t length) {
+        WordTable::Entry& cell = vocabulary.entry(word, length);
+        if (cell.count == 0) {
+            words.push_back(cell.word);
+            lengths.push_back(cell.length);
+            cell.count = static_cast<int>(words.size());
+        }
+
+        if (filled == n) {
+            std::memmove(window, window + 1, (n - 1) * sizeof(window[0]));
+            --filled;
+        }
+        window[filled++] = static_cast<uint32_t>(cell.count);
+        if (filled == n) {
+            countWindow();
+        }
+    }
+
+    // Разрыв последовательности (конец файла): n-граммы не переходят через него
+    void breakSequence() { filled = 0; }
+
+    // Длина n-грамм
+    size_t length() const { return n; }
+
+    // Номер i-го слова n-граммы
+    static uint32_t wordId(const Entry& entry, size_t i) {
+        return static_cast<uint32_t>(entry.key[i / 2] >> (i % 2 == 0 ? 32 : 0));
+    }
+
+    // Слово по номеру (не завершается нулем) и его длина
+    const char* word(uint32_t id) const { return words[id - 1]; }
+    size_t wordLength(uint32_t id) const { return lengths[id - 1]; }
+
+    // Обход всех n-грамм
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (const Entry& entry : slots) {
+            if (entry.count != 0) {
+                visit(entry);
+            }
+        }
+    }
+
+    // Количество различных n-грамм
+    size_t size() const { return used; }
+
+    // Объем памяти в байтах
+    size_t memoryUsage() const {
+        return slots.capacity() * sizeof(Entry) + vocabulary.memoryUsage()
+            + words.capacity() * sizeof(const char*) + lengths.capacity() * sizeof(uint32_t);
+    }
+};
+
+// Файл, отображенный в память только для чтения
+class MappedFile {
+private:
+    const char* bytes = nullptr;   // Начало отображения
+    size_t length = 0;             // Размер файла
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes != nullptr) UnmapViewOfFile(bytes);
+        if (mapping != nullptr) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (bytes != nullptr) munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+
+    // Отображение файла; false - если файл нельзя открыть или отобразить
+    bool open(const std::string& filename) {
+#ifdef _WIN32
+        file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) return false;
+        length = static_cast<size_t>(size.QuadPart);
+        // Пустой файл отобразить нельзя, но он и не содержит слов
+        if (length == 0) return true;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) return false;
+        bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        return bytes != nullptr;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* area = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (area != MAP_FAILED) {
+                madvise(area, length, MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(area);
+            }
+        }
+        close(fd);
+        return length == 0 || bytes != nullptr;
+#endif
+    }
+
+    const char* data() const { return bytes; }
+
+    size_t size() const { return length; }
+};
+
+// Снимок таблицы частот в двоичном файле. Файл отображается в память и используется
+// без разбора, поэтому открытие почти мгновенно и не требует памяти на каждое слово.
+// Формат (числа в порядке байтов машины):
+//   заголовок: "WFSNAP02", количество слов n, размер блока строк (по 8 байт);
+//   n + 1 записей "смещение начала слова в блоке строк, частота" (по 16 байт),
+//   последняя запись - конец блока строк с частотой 0;
+//   блок строк - слова подряд, по возрастанию (побайтовое сравнение)
+class WordSnapshot {
+private:
+    struct Header {
+        char magic[8];
+        uint64_t words;
+        uint64_t blobSize;
+    };
+
+    struct Record {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    MappedFile file;
+    const Record* records = nullptr;
+    const char* blob = nullptr;
+    size_t words = 0;
+
+    // Запись снимка в файл path за один обход слов. Записи таблицы пишутся сразу на свое место,
+    // слова - в промежуточный файл, который затем дописывается в конец снимка,
+    // а заголовок заполняется последним
+    template <typename Walk>
+    static bool writeTemporary(const std::string& path, Walk walk) {
+        std::string wordsPath = path + ".words";
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::ofstream wordsOut(wordsPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open() || !wordsOut.is_open()) {
+            std::remove(wordsPath.c_str());
+            return false;
+        }
+
+        Header header;
+        std::memcpy(header.magic, "WFSNAP02", 8);
+        header.words = 0;
+        header.blobSize = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        walk([&](const char* word, size_t length, uint64_t count) {
+            Record record = { header.blobSize, count };
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            wordsOut.write(word, length);
+            ++header.words;
+            header.blobSize += length;
+        });
+        Record last = { header.blobSize, 0 };
+        out.write(reinterpret_cast<const char*>(&last), sizeof(last));
+        bool ok = static_cast<bool>(wordsOut.flush());
+        wordsOut.close();
+
+        // Перенос слов в конец снимка
+        if (ok && header.blobSize > 0) {
+            std::ifstream wordsIn(wordsPath, std::ios::binary);
+            ok = wordsIn.is_open() && static_cast<bool>(out << wordsIn.rdbuf());
+        }
+        std::remove(wordsPath.c_str());
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return ok && static_cast<bool>(out.flush());
+    }
+
+    // Замена файла filename записанным временным файлом path
+    static bool replaceFile(const std::string& path, const std::string& filename) {
+#ifdef _WIN32
+        bool replaced = MoveFileExA(path.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        bool replaced = std::rename(path.c_str(), filename.c_str()) == 0;
+#endif
+        if (!replaced) {
+            std::remove(path.c_str());
+        }
+        return replaced;
+    }
+
+public:
+    // Открытие снимка; false - если файл нельзя отобразить или он поврежден
+    bool open(const std::string& filename) {
+        if (!file.open(filename) || file.size() < sizeof(Header)) return false;
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, "WFSNAP02", 8) != 0) return false;
+
+        // Проверка размеров до обращения к разделам
+        uint64_t available = file.size() - sizeof(Header);
+        if (available < sizeof(Record) || header.words > available / sizeof(Record) - 1
+            || header.blobSize != available - (header.words + 1) * sizeof(Record)) return false;
+        records = reinterpret_cast<const Record*>(file.data() + sizeof(Header));
+        blob = reinterpret_cast<const char*>(records + header.words + 1);
+        words = static_cast<size_t>(header.words);
+        if (records[words].offset != header.blobSize) return false;
+        for (size_t i = 0; i < words; ++i) {
+            if (records[i].offset > records[i + 1].offset) return false;
+        }
+        return true;
+    }
+
+    // Количество слов
+    size_t size() const { return words; }
+
+    // Слово с номером i (не завершается нулем) и его длина
+    const char* word(size_t i) const { return blob + records[i].offset; }
+    size_t length(size_t i) const { return static_cast<size_t>(records[i + 1].offset - records[i].offset); }
+
+    // Частота слова с номером i
+    uint64_t count(size_t i) const { return records[i].count; }
+
+    // Номер первого слова, не меньшего заданного (двоичный поиск)
+    size_t lowerBound(const char* text, size_t textLength) const {
+        size_t first = 0;
+        size_t count = words;
+        while (count > 0) {
+            size_t half = count / 2;
+            if (wordLess(word(first + half), length(first + half), text, textLength)) {
+                first += half + 1;
+                count -= half + 1;
+            }
+            else {
+                count = half;
+            }
+        }
+        return first;
+    }
+
+    // Частота слова; 0 - если его нет в снимке
+    uint64_t find(const char* text, size_t textLength) const {
+        size_t i = lowerBound(text, textLength);
+        if (i < words && length(i) == textLength && std::memcmp(word(i), text, textLength) == 0) {
+            return records[i].count;
+        }
+        return 0;
+    }
+
+    // Запись снимка. walk(visit) должен вызывать visit(слово, длина, частота) для всех слов
+    // по возрастанию; обход выполняется один раз. Снимок пишется во временный файл
+    // рядом с filename и заменяет его только после успешной записи
+    template <typename Walk>
+    static bool write(const std::string& filename, Walk walk) {
+        std::string path = filename + ".tmp";
+        if (!writeTemporary(path, walk)) {
+            std::remove(path.c_str());
+            return false;
+        }
+        return replaceFile(path, filename);
+    }
+
+    // Слияние снимков в один: частоты одинаковых слов складываются.
+    // Снимки сливаются k-путевым слиянием за один проход, память не зависит от количества слов.
+    // Результат можно записать на место одного из исходных снимков
+    static bool merge(const std::vector<std::string>& inputs, const std::string& output) {
+        std::string path = output + ".tmp";
+        bool written = false;
+        {
+            std::vector<std::unique_ptr<WordSnapshot>> sources;
+            for (const std::string& input : inputs) {
+                sources.emplace_back(new WordSnapshot());
+                if (!sources.back()->open(input)) return false;
+            }
+
+            std::vector<size_t> cursors(sources.size(), 0);
+            std::vector<size_t> heap;
+            // Куча источников: наверху - источник с наименьшим текущим словом
+            auto later = [&](size_t a, size_t b) {
+                const WordSnapshot& x = *sources[a];
+                const WordSnapshot& y = *sources[b];
+                return wordLess(y.word(cursors[b]), y.length(cursors[b]), x.word(cursors[a]), x.length(cursors[a]));
+            };
+            for (size_t i = 0; i < sources.size(); ++i) {
+                if (sources[i]->size() > 0) heap.push_back(i);
+            }
+            std::make_heap(heap.begin(), heap.end(), later);
+
+            written = writeTemporary(path, [&](auto visit) {
+                while (!heap.empty()) {
+                    const WordSnapshot& top = *sources[heap.front()];
+                    const char* word = top.word(cursors[heap.front()]);
+                    size_t length = top.length(cursors[heap.front()]);
+                    uint64_t total = 0;
+                    // Сбор частот слова из всех источников, где оно есть
+                    while (!heap.empty()) {
+                        size_t source = heap.front();
+                        const WordSnapshot& snapshot = *sources[source];
+                        size_t i = cursors[source];
+                        if (snapshot.length(i) != length || std::memcmp(snapshot.word(i), word, length) != 0) break;
+                        total += snapshot.count(i);
+                        std::pop_heap(heap.begin(), heap.end(), later);
+                        if (++cursors[source] < snapshot.size()) {
+                            std::push_heap(heap.begin(), heap.end(), later);
+                        }
+                        else {
+                            heap.pop_back();
+                        }
+                    }
+                    visit(word, length, total);
+                }
+            });
+        }
+
+        // Исходные снимки уже закрыты, поэтому результат может заменить любой из них
+        if (!written) {
+            std::remove(path.c_str());
+            return false;
+        }
+        return replaceFile(path, output);
+    }
+};
+
+// Таблица классов символов для разбора текста: для каждого из 256 значений байта
+// хранятся признаки (разделитель, удаляемая пунктуация, заглавная буква) и строчный вариант
+class CharTable {
+public:
+    static const unsigned char SEPARATOR = 1;   // Разделитель слов
+    static const unsigned char DROPPED = 2;     // Пунктуация, удаляемая из слова
+    static const unsigned char UPPER = 4;       // Символ меняется при приведении к нижнему регистру
+    static const unsigned char NON_ASCII = 8;   // Байт вне ASCII: слово разбирается как UTF-8
+
+private:
+    unsigned char flags[256];
+    char lower[256];
+
+public:
+    // Построение таблицы по текущей локали с заданным набором разделителей слов
+    explicit CharTable(const std::string& separators) {
+        for (int c = 0; c < 256; ++c) {
+            flags[c] = 0;
+            lower[c] = static_cast<char>(std::tolower(c));
+            if (std::ispunct(c)) flags[c] |= DROPPED;
+            if (lower[c] != static_cast<char>(c)) flags[c] |= UPPER;
+            if (c >= 0x80) flags[c] |= NON_ASCII;
+        }
+        for (char c : separators) {
+            flags[static_cast<unsigned char>(c)] = SEPARATOR;
+        }
+    }
+
+    unsigned char flagsOf(char c) const { return flags[static_cast<unsigned char>(c)]; }
+
+    char toLower(char c) const { return lower[static_cast<unsigned char>(c)]; }
+};
+
+// Разбор UTF-8 и приведение символов к нижнему регистру без обращения к локали.
+// Таблица покрывает латиницу, греческий, кириллицу и армянский; остальные символы не меняются
+class Utf8Folder {
+private:
+    static const uint32_t TABLE_SIZE = 0x0560;
+
+    uint16_t lower[TABLE_SIZE];
+
+    // Пары "заглавная, строчная", идущие подряд: заглавная на четной (odd = false)
+    // или нечетной (odd = true) позиции
+    void pairs(uint32_t first, uint32_t last, bool odd) {
+        for (uint32_t c = first; c < last; ++c) {
+            if ((c & 1) == (odd ? 1u : 0u)) lower[c] = static_cast<uint16_t>(c + 1);
+        }
+    }
+
+    void shift(uint32_t first, uint32_t last, uint32_t offset) {
+        for (uint32_t c = first; c <= last; ++c) {
+            lower[c] = static_cast<uint16_t>(c + offset);
+        }
+    }
+
+public:
+    Utf8Folder() {
+        for (uint32_t c = 0; c < TABLE_SIZE; ++c) {
+            lower[c] = static_cast<uint16_t>(c);
+        }
+        // Латиница
+        shift('A', 'Z', 32);
+        shift(0x00C0, 0x00DE, 32);
+        lower[0x00D7] = 0x00D7;
+        pairs(0x0100, 0x0130, false);
+        lower[0x0130] = 'i';
+        pairs(0x0132, 0x0138, false);
+        pairs(0x0139, 0x0149, true);
+        pairs(0x014A, 0x0178, false);
+        lower[0x0178] = 0x00FF;
+        pairs(0x0179, 0x017F, true);
+        lower[0x017F] = 's';
+        pairs(0x01CD, 0x01DD, true);
+        pairs(0x01DE, 0x01F0, false);
+        pairs(0x01F8, 0x0220, false);
+        pairs(0x0222, 0x0234, false);
+        // Греческий; конечная сигма приводится к обычной
+        lower[0x0386] = 0x03AC;
+        shift(0x0388, 0x038A, 37);
+        lower[0x038C] = 0x03CC;
+        shift(0x038E, 0x038F, 63);
+        shift(0x0391, 0x03A1, 32);
+        shift(0x03A3, 0x03AB, 32);
+        lower[0x03C2] = 0x03C3;
+        pairs(0x03D8, 0x03F0, false);
+        // Кириллица
+        shift(0x0400, 0x040F, 80);
+        shift(0x0410, 0x042F, 32);
+        pairs(0x0460, 0x0482, false);
+        pairs(0x048A, 0x04C0, false);
+        lower[0x04C0] = 0x04CF;
+        pairs(0x04C1, 0x04CF, true);
+        pairs(0x04D0, 0x0530, false);
+        // Армянский
+        shift(0x0531, 0x0556, 48);
+    }
+
+    // Декодирование символа; количество байт либо 0, если последовательность неверна
+    // (обрыв, лишний байт продолжения, избыточная длина, суррогат или значение вне Юникода)
+    static size_t decode(const char* text, const char* end, uint32_t& code) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+        size_t available = end - text;
+        unsigned char lead = p[0];
+        size_t length;
+        uint32_t minimum;
+        if (lead < 0x80) {
+            code = lead;
+            return 1;
+        }
+        else if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+            code = lead & 0x1F;
+            minimum = 0x80;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            code = lead & 0x0F;
+            minimum = 0x800;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            code = lead & 0x07;
+            minimum = 0x10000;
+        }
+        else {
+            return 0;
+        }
+        if (available < length) return 0;
+        for (size_t i = 1; i < length; ++i) {
+            if ((p[i] & 0xC0) != 0x80) return 0;
+            code = (code << 6) | (p[i] & 0x3F);
+        }
+        if (code < minimum || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return 0;
+        return length;
+    }
+
+    // Запись символа в UTF-8
+    static void append(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    // Строчный вариант символа
+    uint32_t fold(uint32_t code) const {
+        if (code < TABLE_SIZE) return lower[code];
+        if (code >= 0x1E00 && code <= 0x1E95 && (code & 1) == 0) return code + 1;
+        if (code >= 0x1EA0 && code <= 0x1EFF && (code & 1) == 0) return code + 1;
+        if (code >= 0xFF21 && code <= 0xFF3A) return code + 32;
+        return code;
+    }
+
+    // Знаки препинания и символы вне ASCII, удаляемые из слова, как ispunct для ASCII
+    static bool isPunctuation(uint32_t code) {
+        if (code >= 0x00A0 && code <= 0x00BF) {
+            // Кроме букв и цифр этого блока: ª ² ³ µ ¹ º ¼ ½ ¾
+            return code != 0xAA && code != 0xB2 && code != 0xB3 && code != 0xB5 && code != 0xB9
+                && code != 0xBA && code != 0xBC && code != 0xBD && code != 0xBE;
+        }
+        return code == 0x00D7 || code == 0x00F7 || code == 0xFEFF
+            || (code >= 0x2000 && code <= 0x206F)    // Общая пунктуация (кавычки, тире, многоточие)
+            || (code >= 0x20A0 && code <= 0x20CF)    // Знаки валют
+            || (code >= 0x2E00 && code <= 0x2E7F)    // Дополнительная пунктуация
+            || (code >= 0x3000 && code <= 0x303F)    // Пунктуация CJK
+            || (code >= 0xFF01 && code <= 0xFF0F) || (code >= 0xFF1A && code <= 0xFF20)
+            || (code >= 0xFF3B && code <= 0xFF40) || (code >= 0xFF5B && code <= 0xFF65);
+    }
+};
+
+// Поиск границ слов блоками по 64 байта: для блока строятся битовые маски разделителей
+// и символов, требующих очистки, а слова выделяются по переходам между битами.
+// Маски строятся векторно (AVX2 или SSE4.2, по возможностям процессора) либо по таблице символов
+class WordScanner {
+public:
+    enum Kind { SCALAR, SSE42, AVX2 };
+
+private:
+    CharTable table;
+    Kind active;
+
+    // Набор разделителей для SSE4.2 (не более 16 символов)
+    char setChars[16];
+    int setLength;
+
+    // Таблицы полубайтов для AVX2: байт является разделителем, если
+    // loNibble[младший полубайт] & hiNibble[старший полубайт] != 0 (только для ASCII)
+    unsigned char loNibble[16];
+    unsigned char hiNibble[16];
+    bool asciiSeparators;
+
+    // Номер младшего установленного бита
+    static unsigned lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+#ifdef _M_X64
+        _BitScanForward64(&index, bits);
+#else
+        if (!_BitScanForward(&index, static_cast<unsigned long>(bits))) {
+            _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+            index += 32;
+        }
+#endif
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+    }
+
+    // Проверка возможностей процессора
+    static bool cpuSupports(Kind kind) {
+#ifdef WORD_SCANNER_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        if (kind == SSE42) return (info[2] >> 20) & 1;
+        if (kind == AVX2) {
+            // AVX2 требует поддержки сохранения регистров AVX операционной системой
+            bool osxsave = (info[2] >> 27) & 1;
+            if (!osxsave || maxLeaf < 7 || (_xgetbv(0) & 6) != 6) return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] >> 5) & 1;
+        }
+#else
+        __builtin_cpu_init();
+        if (kind == SSE42) return __builtin_cpu_supports("sse4.2") != 0;
+        if (kind == AVX2) return __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+        return kind == SCALAR;
+    }
+
+    // Маски по таблице символов; используется и для неполного блока в конце текста
+    void classifyScalar(const char* block, size_t length, uint64_t& separators, uint64_t& dirty) const {
+        separators = 0;
+        dirty = 0;
+        for (size_t i = 0; i < length; ++i) {
+            unsigned char flags = table.flagsOf(block[i]);
+            separators |= static_cast<uint64_t>(flags & CharTable::SEPARATOR) << i;
+            dirty |= static_cast<uint64_t>((flags & ~CharTable::SEPARATOR) != 0) << i;
+        }
+    }
+
+#ifdef WORD_SCANNER_X86
+    // Символы, которые могут потребовать очистки: все, кроме строчных латинских букв и цифр.
+    // Лишние отметки безопасны - такое слово проходит точную очистку по таблице
+    WORD_SCANNER_TARGET("sse4.2")
+    static unsigned cleanMask16(__m128i block) {
+        __m128i letter = _mm_sub_epi8(block, _mm_set1_epi8('a'));
+        __m128i digit = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+        __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+        __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(isLetter, isDigit)));
+    }
+
+    WORD_SCANNER_TARGET("sse4.2")
+    void classifySse42(const char* block, uint64_t& separators, uint64_t& dirty) const {
+        __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(setChars));
+        separators = 0;
+        dirty = 0;
+        for (int i = 0; i < 4; ++i) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+            __m128i found = _mm_cmpestrm(set, setLength, bytes, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+            separators |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(found)) & 0xFFFF) << (16 * i);
+            dirty |= static_cast<uint64_t>(~cleanMask16(bytes) & 0xFFFF) << (16 * i);
+        }
+    }
+
+    WORD_SCANNER_TARGET("avx2")
+    void classifyAvx2(const char* block, uint64_t& separators, uint64_t& dirty) const {
+        __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(loNibble)));
+        __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hiNibble)));
+        __m256i nibble = _mm256_set1_epi8(0x0F);
+        __m256i zero = _mm256_setzero_si256();
+        separators = 0;
+        dirty = 0;
+        for (int i = 0; i < 2; ++i) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+            __m256i loClass = _mm256_shuffle_epi8(lo, _mm256_and_si256(bytes, nibble));
+            __m256i hiClass = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+            __m256i notSeparator = _mm256_cmpeq_epi8(_mm256_and_si256(loClass, hiClass), zero);
+
+            __m256i letter = _mm256_sub_epi8(bytes, _mm256_set1_epi8('a'));
+            __m256i digit = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+            __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+            __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+
+            uint32_t separatorBits = ~static_cast<uint32_t>(_mm256_movemask_epi8(notSeparator));
+            uint32_t cleanBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(isLetter, isDigit)));
+            separators |= static_cast<uint64_t>(separatorBits) << (32 * i);
+            dirty |= static_cast<uint64_t>(~cleanBits) << (32 * i);
+        }
+    }
+#endif
+
+public:
+    // separators - символы, разделяющие слова. Выбирается самая быстрая реализация,
+    // доступная на процессоре и подходящая для набора разделителей
+    explicit WordScanner(const std::string& separators)
+        : table(separators), active(SCALAR), setLength(0), asciiSeparators(true) {
+        std::memset(setChars, 0, sizeof(setChars));
+        std::memset(loNibble, 0, sizeof(loNibble));
+        for (int h = 0; h < 16; ++h) {
+            hiNibble[h] = static_cast<unsigned char>(h < 8 ? 1 << h : 0);
+        }
+
+        std::string unique;
+        for (char c : separators) {
+            if (unique.find(c) == std::string::npos) unique += c;
+        }
+        for (char c : unique) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (byte >= 0x80) asciiSeparators = false;
+            else loNibble[byte & 0x0F] |= static_cast<unsigned char>(1 << (byte >> 4));
+        }
+        if (unique.size() <= sizeof(setChars)) {
+            setLength = static_cast<int>(unique.size());
+            std::memcpy(setChars, unique.data(), unique.size());
+        }
+
+        if (!select(AVX2)) select(SSE42);
+    }
+
+    // Выбор реализации; false - если она недоступна на процессоре или для набора разделителей
+    bool select(Kind kind) {
+        if (!cpuSupports(kind)) return false;
+        if (kind == AVX2 && !asciiSeparators) return false;
+        if (kind == SSE42 && (setLength == 0 || setLength > static_cast<int>(sizeof(setChars)))) return false;
+        active = kind;
+        return true;
+    }
+
+    Kind kind() const { return active; }
+
+    const CharTable& chars() const { return table; }
+
+    // Маски блока длиной не более 64 байт: бит i в separators - байт i является разделителем,
+    // в dirty - байт i может требовать удаления или приведения к нижнему регистру
+    void classify(const char* block, size_t length, uint64_t& separators, uint64_t& dirty) const {
+#ifdef WORD_SCANNER_X86
+        if (length == 64) {
+            if (active == AVX2) {
+                classifyAvx2(block, separators, dirty);
+                return;
+            }
+            if (active == SSE42) {
+                classifySse42(block, separators, dirty);
+                return;
+            }
+        }
+#endif
+        classifyScalar(block, length, separators, dirty);
+    }
+
+    // Обход слов текста: visit(начало, длина, dirty), где dirty - слово может требовать очистки
+    template <typename Visitor>
+    void forEachWord(const char* text, size_t size, Visitor visit) const {
+        size_t wordStart = 0;
+        bool inWord = false;
+        bool dirty = false;
+        for (size_t base = 0; base < size; base += 64) {
+            size_t length = std::min<size_t>(64, size - base);
+            uint64_t separators, dirtyBits;
+            classify(text + base, length, separators, dirtyBits);
+            if (length < 64) {
+                separators |= ~0ULL << length;
+            }
+
+            // Начала слов - символы после разделителя, концы - разделители после символа слова
+            uint64_t word = ~separators;
+            uint64_t afterWord = (word << 1) | (inWord ? 1 : 0);
+            uint64_t starts = word & ~afterWord;
+            uint64_t ends = separators & afterWord;
+
+            size_t from = 0;
+            for (uint64_t events = starts | ends; events != 0; events &= events - 1) {
+                unsigned i = lowestBit(events);
+                if ((starts >> i) & 1) {
+                    wordStart = base + i;
+                    from = i;
+                    dirty = false;
+                    inWord = true;
+                }
+                else {
+                    uint64_t range = ((1ULL << i) - 1) >> from << from;
+                    dirty = dirty || (dirtyBits & range) != 0;
+                    visit(text + wordStart, base + i - wordStart, dirty);
+                    inWord = false;
+                }
+            }
+            if (inWord) {
+                dirty = dirty || (dirtyBits >> from) != 0;
+            }
+        }
+        if (inWord) {
+            visit(text + wordStart, size - wordStart, dirty);
+        }
+    }
+};
+
+// Параметры выборки слов
+struct WordQuery {
+    int minCount;        // Минимальная частота слова
+    size_t limit;        // Наибольшее число слов в результате (0 - без ограничения)
+    std::string prefix;  // Начало слова в нижнем регистре (пустая строка - любые слова)
+
+    explicit WordQuery(int minCount = 1, size_t limit = 0, const std::string& prefix = "")
+        : minCount(minCount), limit(limit), prefix(prefix) {
+    }
+};
+
+// Результат выборки: просмотр ячеек таблицы частот без копирования слов.
+// Действителен до следующей выборки или подсчета слов
+class WordList {
+private:
+    const WordTable::Entry* const* first;
+    size_t count;
+
+public:
+    WordList(const WordTable::Entry* const* first, size_t count) : first(first), count(count) {}
+
+    const WordTable::Entry* const* begin() const { return first; }
+    const WordTable::Entry* const* end() const { return first + count; }
+    const WordTable::Entry& operator[](size_t i) const { return *first[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
 class WordFrequencyCounter {
+public:
+    // Кодировка текста вне ASCII
+    enum Encoding {
+        UTF8,          // UTF-8; байты, не образующие верной последовательности, - по таблице локали
+        SINGLE_BYTE    // Однобайтовая кодировка локали (например, CP1251): все байты - по таблице локали
+    };
+
+private:
+    // Контейнер для хранения частоты слов
+    // Ключ - слово, значение - количество повторений
+    WordTable wordFrequency;
+
+    // Поиск слов и классы символов для разбора текста
+    WordScanner scanner;
+
+    // Приведение к нижнему регистру символов UTF-8
+    Utf8Folder folder;
+
+    // Кодировка входного текста
+    Encoding encoding = UTF8;
+
+    // Буфер для слова, из которого нужно удалить пунктуацию или заглавные буквы
+    std::string cleanedWord;
+
+    // Приближенный подсчет в памяти фиксированного размера (nullptr - точный подсчет)
+    std::unique_ptr<WordSketch> sketch;
+
+    // Подсчет n-грамм вместо отдельных слов (nullptr - подсчет слов)
+    std::unique_ptr<NGramTable> ngrams;
+
+    // Незаконченное слово в конце последней порции потоковых данных
+    std::string pending;
+
+    // Буфер чтения потока
+    std::vector<char> readBuffer;
+
+    // Результат последней выборки слов
+    std::vector<const WordTable::Entry*> queryResult;
+
+    // Порядок выдачи: по убыванию частоты, слова с равной частотой - по алфавиту
+    static bool ranksBefore(const WordTable::Entry* a, const WordTable::Entry* b) {
+        if (a->count != b->count) {
+            return a->count > b->count;
+        }
+        return wordLess(a->word, a->length, b->word, b->length);
+    }
+
+    // Учет слова: считаются только слова длиннее 3 символов (не байт)
+    static void countWord(WordTable& target, const char* word, size_t length, size_t characters) {
+        if (characters > 3) {
+            target(word, length)++;
+        }
+    }
+
+    static void countWord(WordSketch& target, const char* word, size_t length, size_t characters) {
+        if (characters > 3) {
+            target.add(word, length);
+        }
+    }
+
+    // В n-граммах участвуют слова любой длины
+    static void countWord(NGramTable& target, const char* word, size_t length, size_t characters) {
+        if (characters > 0) {
+            target.add(word, length);
+        }
+    }
+
+    // Вызов action для текущей цели подсчета: таблицы n-грамм, скетча или таблицы слов
+    template <typename Action>
+    void withTarget(Action action) {
+        if (ngrams) {
+            action(*ngrams);
+        }
+        else if (sketch) {
+            action(*sketch);
+        }
+        else {
+            action(wordFrequency);
+        }
+    }
+
+    // Цель подсчета одна на счетчик и не делится между потоками
+    bool sequentialOnly() const { return sketch || ngrams; }
+
+    // Разбор блока текста на слова прямо по исходным байтам с подсчетом в таблицу target.
+    // Слово копируется в буфер cleaned только тогда, когда его нужно очистить
+    // от пунктуации или привести к нижнему регистру
+    template <typename Target>
+    void countBuffer(const char* text, size_t size, Target& target, std::string& cleaned) const {
+        const CharTable& table = scanner.chars();
+        scanner.forEachWord(text, size, [&](const char* word, size_t length, bool dirty) {
+            if (!dirty) {
+                countWord(target, word, length, length);
+                return;
+            }
+
+            // Очистка слова от пунктуации и приведение к нижнему регистру.
+            // В режиме UTF8 символы вне ASCII разбираются как UTF-8; байты, не образующие верной
+            // последовательности UTF-8, и все байты в режиме SINGLE_BYTE обрабатываются по таблице текущей локали
+            cleaned.clear();
+            size_t characters = 0;
+            const char* end = word + length;
+            for (const char* c = word; c < end;) {
+                uint32_t code;
+                size_t bytes = encoding == UTF8 && (table.flagsOf(*c) & CharTable::NON_ASCII)
+                    ? Utf8Folder::decode(c, end, code) : 0;
+                if (bytes == 0) {
+                    if (!(table.flagsOf(*c) & CharTable::DROPPED)) {
+                        cleaned += table.toLower(*c);
+                        ++characters;
+                    }
+                    ++c;
+                    continue;
+                }
+                if (!Utf8Folder::isPunctuation(code)) {
+                    Utf8Folder::append(cleaned, folder.fold(code));
+                    ++characters;
+                }
+                c += bytes;
+            }
+            countWord(target, cleaned.data(), cleaned.size(), characters);
+        });
+    }
+
+    // Разбор очередной порции потока. Слово, не закончившееся в конце порции,
+    // накапливается в pending и учитывается, когда в следующих порциях встретится разделитель
+    template <typename Target>
+    void feedBuffer(const char* data, size_t size, Target& target, std::string& cleaned) {
+        const CharTable& table = scanner.chars();
+        const char* end = data + size;
+        const char* pos = data;
+        if (!pending.empty()) {
+            while (pos < end && !(table.flagsOf(*pos) & CharTable::SEPARATOR)) {
+                ++pos;
+            }
+            pending.append(data, pos);
+            if (pos == end) {
+                return;
+            }
+            countBuffer(pending.data(), pending.size(), target, cleaned);
+            pending.clear();
+        }
+
+        // Все до последнего разделителя разбирается сразу, остаток ждет продолжения
+        const char* last = end;
+        while (last > pos && !(table.flagsOf(last[-1]) & CharTable::SEPARATOR)) {
+            --last;
+        }
+        countBuffer(pos, last - pos, target, cleaned);
+        pending.append(last, end);
+    }
+
+    // Параллельное выполнение задач 0..tasks-1: каждый поток считает слова в свою таблицу,
+    // затем таблицы сливаются в wordFrequency
+    template <typename Task>
+    void runParallel(size_t tasks, size_t threadCount, Task task) {
+        threadCount = std::max<size_t>(1, std::min(threadCount, tasks));
+        std::vector<WordTable> local(threadCount);
+        std::atomic<size_t> next(0);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&, t] {
+                std::string cleaned;
+                for (size_t i = next++; i < tasks; i = next++) {
+                    task(i, local[t], cleaned);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        mergeTables(local);
+    }
+
+    // Слияние таблиц потоков и накопленных ранее частот в wordFrequency
+    void mergeTables(std::vector<WordTable>& local) {
+        size_t threadCount = local.size();
+        local.push_back(std::move(wordFrequency));
+        wordFrequency = WordTable::merge(local, threadCount);
+    }
+
+    // Число потоков по умолчанию
+    static size_t defaultThreads() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Подсчет слов файла в таблицу target. Обычный файл отображается в память
+    // и разбирается без копирования; если отобразить файл нельзя, он читается построчно.
+    // false - если файл не удалось открыть
+    template <typename Target>
+    bool countFile(const std::string& filename, Target& target, std::string& cleaned) const {
+        MappedFile mapped;
+        if (mapped.open(filename)) {
+            countBuffer(mapped.data(), mapped.size(), target, cleaned);
+            return true;
+        }
+
+        // Открытие файла для чтения
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        // Чтение файла построчно
+        std::string line;
+        while (std::getline(file, line)) {
+            countBuffer(line.data(), line.size(), target, cleaned);
+        }
+        return true;
+    }
+
+public:
+    // separators - символы, разделяющие слова; перевод строки разделяет слова всегда,
+    // как и при построчном чтении
+    explicit WordFrequencyCounter(const std::string& separators = " .,-:!;")
+        : scanner(separators + "\n\r") {
+    }
+
+    // Приближенный подсчет в памяти фиксированного размера: хранятся только
+    // limits.heavyHitters самых частых слов, их частоты - оценки сверху
+    explicit WordFrequencyCounter(const WordSketch::Limits& limits, const std::string& separators = " .,-:!;")
+        : scanner(separators + "\n\r"), sketch(new WordSketch(limits)) {
+    }
+
+    // Потоковый подсчет: очередная порция данных. Слово может продолжаться в следующей порции;
+    // частоты уже законченных слов доступны через query в любой момент.
+    // После того как словарь перестает расти, память при подсчете не выделяется
+    void feed(const char* data, size_t size) {
+        withTarget([&](auto& target) { feedBuffer(data, size, target, cleanedWord); });
+    }
+
+    // Конец потока: учет последнего незаконченного слова
+    void finish() {
+        withTarget([&](auto& target) { countBuffer(pending.data(), pending.size(), target, cleanedWord); });
+        pending.clear();
+        if (ngrams) ngrams->breakSequence();
+    }
+
+    // Подсчет слов из потока ввода (например, std::cin или канала) до его конца.
+    // Данные, уже прочитанные потоком, разбираются сразу; если их нет, ожидается
+    // только следующая строка, а не полный блок, поэтому медленный источник
+    // (например, tail -f) учитывается по мере поступления строк
+    void processStream(std::istream& in) {
+        const size_t READ_SIZE = 64 * 1024;
+        readBuffer.resize(READ_SIZE);
+        std::string line;
+        while (in) {
+            std::streamsize ready = in.readsome(readBuffer.data(), READ_SIZE);
+            if (ready > 0) {
+                feed(readBuffer.data(), static_cast<size_t>(ready));
+                continue;
+            }
+            if (std::getline(in, line)) {
+                // Перевод строки завершает последнее слово строки
+                if (!in.eof()) line += '\n';
+                feed(line.data(), line.size());
+            }
+        }
+        finish();
+    }
+
+    // Метод для чтения файла и подсчета частоты слов; имя "-" означает стандартный ввод
+    void processFile(const std::string& filename) {
+        if (filename == "-") {
+            processStream(std::cin);
+            return;
+        }
+
+        // Проверка успешности открытия файла
+        bool opened = false;
+        withTarget([&](auto& target) { opened = countFile(filename, target, cleanedWord); });
+        if (ngrams) ngrams->breakSequence();
+        if (!opened) {
+            std::cerr << "Не удалось открыть файл: " << filename << std::endl;
+        }
+    }
+
+    // Параллельный подсчет слов в одном файле: отображенный файл делится на части
+    // по границам слов, каждую часть разбирает свой поток.
+    // Скетч приближенного подсчета и таблица n-грамм общие, поэтому в этих режимах
+    // файл разбирается одним потоком
+    void processFileParallel(const std::string& filename, size_t threadCount = defaultThreads()) {
+        MappedFile mapped;
+        if (sequentialOnly() || !mapped.open(filename) || threadCount <= 1) {
+            processFile(filename);
+            return;
+        }
+
+        // Границы частей сдвигаются вперед до ближайшего разделителя
+        const char* text = mapped.data();
+        size_t size = mapped.size();
+        std::vector<size_t> bounds(1, 0);
+        for (size_t t = 1; t < threadCount; ++t) {
+            size_t bound = std::max(bounds.back(), size / threadCount * t);
+            while (bound < size && !(scanner.chars().flagsOf(text[bound]) & CharTable::SEPARATOR)) {
+                ++bound;
+            }
+            bounds.push_back(bound);
+        }
+        bounds.push_back(size);
+
+        runParallel(threadCount, threadCount, [&](size_t i, WordTable& target, std::string& cleaned) {
+            countBuffer(text + bounds[i], bounds[i + 1] - bounds[i], target, cleaned);
+        });
+    }
+
+    // Параллельный подсчет слов в нескольких файлах: потоки разбирают файлы по очереди
+    void processFiles(const std::vector<std::string>& filenames, size_t threadCount = defaultThreads()) {
+        if (sequentialOnly()) {
+            for (const std::string& filename : filenames) {
+                processFile(filename);
+            }
+            return;
+        }
+
+        std::mutex errorLock;
+        runParallel(filenames.size(), threadCount, [&](size_t i, WordTable& target, std::string& cleaned) {
+            if (!countFile(filenames[i], target, cleaned)) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                std::cerr << "Не удалось открыть файл: " << filenames[i] << std::endl;
+            }
+        });
+    }
+
+    // Выборка слов по частоте и началу слова. При ограничении limit слова отбираются
+    // за один проход через кучу из limit лучших, без сортировки всего словаря
+    WordList query(const WordQuery& request) {
+        queryResult.clear();
+        const char* prefix = request.prefix.data();
+        size_t prefixLength = request.prefix.size();
+
+        auto select = [&](const WordTable::Entry& entry) {
+            if (entry.count < request.minCount || entry.length < prefixLength
+                || std::memcmp(entry.word, prefix, prefixLength) != 0) {
+                return;
+            }
+            if (request.limit == 0 || queryResult.size() < request.limit) {
+                queryResult.push_back(&entry);
+                if (request.limit != 0) {
+                    std::push_heap(queryResult.begin(), queryResult.end(), ranksBefore);
+                }
+            }
+            else if (ranksBefore(&entry, queryResult.front())) {
+                // Вершина кучи - худшее из отобранных слов, оно вытесняется
+                std::pop_heap(queryResult.begin(), queryResult.end(), ranksBefore);
+                queryResult.back() = &entry;
+                std::push_heap(queryResult.begin(), queryResult.end(), ranksBefore);
+            }
+        };
+        if (sketch) {
+            sketch->forEach(select);
+        }
+        else {
+            wordFrequency.forEach(select);
+        }
+
+        if (request.limit == 0) {
+            std::sort(queryResult.begin(), queryResult.end(), ranksBefore);
+        }
+        else {
+            std::sort_heap(queryResult.begin(), queryResult.end(), ranksBefore);
+        }
+        return WordList(queryResult.data(), queryResult.size());
+    }
+
+    // Вывод выбранных слов и их частоты
+    void printWords(const WordQuery& request, std::ostream& out = std::cout) {
+        for (const WordTable::Entry* entry : query(request)) {
+            // Выравнивание по левому краю для слова и по правому для числа
+            out << std::left << std::setw(10) << std::string(entry->word, entry->length)
+                << std::right << std::setw(5) << entry->count
+                << std::endl;
+        }
+    }
+
+    // Сохранение частот в двоичный снимок (см. WordSnapshot)
+    bool saveSnapshot(const std::string& filename) const {
+        std::vector<const WordTable::Entry*> entries;
+        auto collect = [&entries](const WordTable::Entry& entry) { entries.push_back(&entry); };
+        if (sketch) {
+            sketch->forEach(collect);
+        }
+        else {
+            wordFrequency.forEach(collect);
+        }
+        std::sort(entries.begin(), entries.end(), [](const WordTable::Entry* a, const WordTable::Entry* b) {
+            return wordLess(a->word, a->length, b->word, b->length);
+        });
+
+        return WordSnapshot::write(filename, [&entries](auto visit) {
+            for (const WordTable::Entry* entry : entries) {
+                visit(entry->word, entry->length, static_cast<uint64_t>(entry->count));
+            }
+        });
+    }
+
+    // Приближенный ли подсчет
+    bool approximate() const { return sketch != nullptr; }
+
+    // Объем памяти под частоты слов в байтах
+    size_t memoryUsage() const {
+        if (ngrams) return ngrams->memoryUsage();
+        return sketch ? sketch->memoryUsage() : wordFrequency.memoryUsage();
+    }
+
+    // Кодировка входного текста, по умолчанию UTF8. Текст в однобайтовой кодировке
+    // в режиме UTF8 считается неверно: заглавная буква CP1251 перед "Ё" или "«" образует
+    // верную последовательность UTF-8 ("ЪЁ" в "ПОДЪЁМ" - байты 0xDA 0xA8, символ U+06A8).
+    // Для такого текста нужен режим SINGLE_BYTE и локаль с этой кодировкой
+    void setEncoding(Encoding textEncoding) {
+        encoding = textEncoding;
+    }
+
+    // Режим n-грамм: дальше вместо отдельных слов считаются последовательности
+    // из n слов подряд (2 <= n <= 4), включая короткие слова
+    void countNGrams(size_t n) {
+        ngrams.reset(new NGramTable(n));
+    }
+
+    // Вывод n-грамм: minCount и limit из request, prefix - начало первого слова
+    void printNGrams(const WordQuery& request, std::ostream& out = std::cout) {
+        if (!ngrams) return;
+        const NGramTable& table = *ngrams;
+        std::vector<const NGramTable::Entry*> selected;
+        table.forEach([&](const NGramTable::Entry& entry) {
+            uint32_t first = NGramTable::wordId(entry, 0);
+            if (entry.count >= request.minCount && table.wordLength(first) >= request.prefix.size()
+                && std::memcmp(table.word(first), request.prefix.data(), request.prefix.size()) == 0) {
+                selected.push_back(&entry);
+            }
+        });
+
+        // По убыванию частоты, n-граммы с равной частотой - по словам
+        auto before = [&table](const NGramTable::Entry* a, const NGramTable::Entry* b) {
+            if (a->count != b->count) {
+                return a->count > b->count;
+            }
+            for (size_t i = 0; i < table.length(); ++i) {
+                uint32_t x = NGramTable::wordId(*a, i);
+                uint32_t y = NGramTable::wordId(*b, i);
+                if (x == y) continue;
+                return wordLess(table.word(x), table.wordLength(x), table.word(y), table.wordLength(y));
+            }
+            return false;
+        };
+        size_t shown = request.limit == 0 ? selected.size() : std::min(request.limit, selected.size());
+        std::partial_sort(selected.begin(), selected.begin() + shown, selected.end(), before);
+
+        std::string text;
+        for (size_t k = 0; k < shown; ++k) {
+            text.clear();
+            for (size_t i = 0; i < table.length(); ++i) {
+                uint32_t id = NGramTable::wordId(*selected[k], i);
+                if (i > 0) text += ' ';
+                text.append(table.word(id), table.wordLength(id));
+            }
+            out << std::left << std::setw(10) << text
+                << std::right << std::setw(5) << selected[k]->count
+                << std::endl;
+        }
+    }
+
+    // Метод для вывода слов, встречающихся не менее 7 раз
+    void printFrequentWords() {
+        printWords(WordQuery(7));
+    }
+};
+
+// Самопроверки (запуск с ключом --selftest)
+
+// Слово, найденное WordScanner: начало, длина и признак возможной очистки
+struct ScannedWord {
+    size_t start;
+    size_t length;
+    bool dirty;
+};
+
+// Слова текста при текущей реализации сканера
+std::vector<ScannedWord> scanWords(const WordScanner& scanner, const std::string& text) {
+    std::vector<ScannedWord> words;
+    scanner.forEachWord(text.data(), text.size(), [&](const char* word, size_t length, bool dirty) {
+        words.push_back(ScannedWord{ static_cast<size_t>(word - text.data()), length, dirty });
+    });
+    return words;
+}
+
+// Реализации WordScanner (AVX2, SSE4.2, по таблице) против побайтового разбора по таблице символов
+// на случайных текстах. Границы слов должны совпадать точно; векторные маски могут отмечать
+// лишние символы, поэтому слово, требующее очистки по таблице, должно быть отмечено
+// и векторной реализацией, но не наоборот
+bool checkWordScanner() {
+    const char* const names[] = { "по таблице", "SSE4.2", "AVX2" };
+    const std::string separatorSets[] = {
+        " .,-:!;\n\r",
+        " \t\n\r",
+        // Больше 16 разделителей: SSE4.2 недоступна
+        " .,-:!;?()[]{}<>\"'/|\t\n\r",
+        // Разделители вне ASCII (неразрывный пробел и кавычки-елочки в CP1251): AVX2 недоступна
+        " ,\xA0\xAB\xBB\n\r",
+        // Больше 16 разделителей и разделители вне ASCII: только разбор по таблице
+        " .,-:!;?()[]{}<>\"'/|\xA0\xAB\xBB\n\r",
+    };
+    const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_'#";
+
+    std::mt19937 random(14);
+    bool ok = true;
+    for (const std::string& separators : separatorSets) {
+        WordScanner scanner(separators);
+        const CharTable& table = scanner.chars();
+        for (int round = 0; ok && round < 3000; ++round) {
+            // Длины не кратны 64 байтам; слова длиннее блока тоже встречаются
+            std::string text(random() % 400, ' ');
+            size_t wordLength = 1 + random() % (round % 10 == 0 ? 150 : 12);
+            for (size_t i = 0; i < text.size(); ++i) {
+                unsigned kind = random() % 16;
+                if (kind < 3) {
+                    text[i] = separators[random() % separators.size()];
+                }
+                else if (kind < 4) {
+                    text[i] = static_cast<char>(0x80 + random() % 0x80);
+                }
+                else if (kind < 5) {
+                    text[i] = static_cast<char>(random() % 0x80);
+                }
+                else {
+                    text[i] = letters[random() % letters.size()];
+                }
+                if (i % wordLength == 0 && random() % 2 == 0) {
+                    text[i] = separators[random() % separators.size()];
+                }
+            }
+
+            // Эталон: побайтовый разбор по флагам таблицы
+            std::vector<ScannedWord> expected;
+            for (size_t i = 0; i < text.size();) {
+                if (table.flagsOf(text[i]) & CharTable::SEPARATOR) {
+                    ++i;
+                    continue;
+                }
+                ScannedWord word = { i, 0, false };
+                for (; i < text.size() && !(table.flagsOf(text[i]) & CharTable::SEPARATOR); ++i) {
+                    word.dirty = word.dirty || table.flagsOf(text[i]) != 0;
+                }
+                word.length = i - word.start;
+                expected.push_back(word);
+            }
+
+            for (WordScanner::Kind kind : { WordScanner::SCALAR, WordScanner::SSE42, WordScanner::AVX2 }) {
+                if (!scanner.select(kind)) continue;
+                std::vector<ScannedWord> words = scanWords(scanner, text);
+                bool same = words.size() == expected.size();
+                for (size_t i = 0; same && i < words.size(); ++i) {
+                    same = words[i].start == expected[i].start && words[i].length == expected[i].length
+                        && (words[i].dirty || !expected[i].dirty)
+                        && (kind != WordScanner::SCALAR || words[i].dirty == expected[i].dirty);
+                }
+                if (!same) {
+                    std::cout << "WordScanner (" << names[kind] << "): расхождение с разбором по таблице, длина текста "
+                        << text.size() << ", разделителей " << separators.size() << std::endl;
+                    ok = false;
+                }
+            }
+        }
+
+        std::cout << "  разделителей " << std::setw(2) << separators.size() << ", проверено:";
+        for (WordScanner::Kind kind : { WordScanner::SCALAR, WordScanner::SSE42, WordScanner::AVX2 }) {
+            if (scanner.select(kind)) std::cout << " " << names[kind];
+        }
+        std::cout << std::endl;
+    }
+    return ok;
+}
+
+// Все самопроверки режима --selftest, true - если все пройдены
+bool runSelfTests() {
+    bool scanner = checkWordScanner();
+    std::cout << "WordScanner (векторные и табличный пути): " << (scanner ? "пройдено" : "ошибка") << std::endl;
+    return scanner;
+}
+
+// Замеры производительности (запуск с ключом --bench [файл])
+
+// Прежний подсчет: std::map и посимвольное накопление слова для каждой строки файла.
+// Используется только для сравнения с WordTable
+class MapWordCounter {
 private:
-    // Контейнер для хранения частоты слов
-    // Ключ - слово, значение - количество повторений
     std::map<std::string, int> wordFrequency;
 
-    // Метод для проверки, является ли символ разделителем слов
-    bool isSeparator(char c) {
+    static bool isSeparator(char c) {
         return c == ' ' || c == '.' || c == ',' || c == '-' ||
             c == ':' || c == '!' || c == ';';
     }
 
-    // Метод для очистки слова от пунктуации и приведения к нижнему регистру
-    std::string cleanWord(const std::string& word) {
+    static std::string cleanWord(const std::string& word) {
         std::string cleaned;
         for (char c : word) {
-            if (!ispunct(c)) {
-                cleaned += std::tolower(c);
+            if (!std::ispunct(static_cast<unsigned char>(c))) {
+                cleaned += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
             }
         }
         return cleaned;
     }
 
+    void countWord(const std::string& word) {
+        std::string cleaned = cleanWord(word);
+        if (cleaned.length() > 3) {
+            wordFrequency[cleaned]++;
+        }
+    }
+
 public:
-    // Метод для чтения файла и подсчета частоты слов
     void processFile(const std::string& filename) {
-        // Открытие файла для чтения
         std::ifstream file(filename);
-
-        // Проверка успешности открытия файла
-        if (!file.is_open()) {
-            std::cerr << "Не удалось открыть файл: " << filename << std::endl;
-            return;
-        }
-
-        // Буфер для чтения строк файла
         std::string line;
-
-        // Чтение файла построчно
         while (std::getline(file, line)) {
-            // Буфер для накопления текущего слова
             std::string word;
-
-            // Проход по каждому символу в строке
             for (char c : line) {
-                // Если встретили разделитель
                 if (isSeparator(c)) {
-                    // Если слово не пустое
                     if (!word.empty()) {
-                        // Очистка слова от пунктуации
-                        std::string cleanedWord = cleanWord(word);
-
-                        // Учитываем только слова длиннее 3 символов
-                        if (cleanedWord.length() > 3) {
-                            // Увеличиваем счетчик частоты слова
-                            wordFrequency[cleanedWord]++;
-                        }
-
-                        // Очистка буфера слова
+                        countWord(word);
                         word.clear();
                     }
                 }
                 else {
-                    // Накопление символов в текущее слово
                     word += c;
                 }
             }
-
-            // Обработка последнего слова в строке
             if (!word.empty()) {
-                std::string cleanedWord = cleanWord(word);
-                if (cleanedWord.length() > 3) {
-                    wordFrequency[cleanedWord]++;
-                }
+                countWord(word);
             }
         }
     }
 
-    // Метод для вывода слов, встречающихся не менее 7 раз
-    void printFrequentWords() {
-        // Создаем вектор пар для сортировки по частоте
-        std::vector<std::pair<std::string, int>> sortedWords;
+    const std::map<std::string, int>& frequencies() const { return wordFrequency; }
+};
+
+// Время выполнения действия в секундах
+template <typename Action>
+double elapsedSeconds(Action action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Синтетический текст для замеров: vocabulary слов с частотами по закону Ципфа.
+// Часть слов начинается с заглавной буквы или окружена кавычками и знаками препинания;
+// cyrillicShare - доля русских слов (в UTF-8)
+std::string makeCorpus(size_t bytes, size_t vocabulary, double cyrillicShare, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
 
-        // Заполнение вектора словами, встречающимися не менее 7 раз
-        for (const auto& pair : wordFrequency) {
-            if (pair.second >= 7) {
-                sortedWords.push_back(pair);
+    std::vector<std::string> words(vocabulary);
+    std::vector<bool> cyrillic(vocabulary);
+    std::vector<double> weights(vocabulary);
+    for (size_t i = 0; i < vocabulary; ++i) {
+        cyrillic[i] = chance(random) < cyrillicShare;
+        size_t length = 2 + random() % 11;
+        for (size_t k = 0; k < length; ++k) {
+            if (cyrillic[i]) {
+                // Строчные буквы а..я: U+0430..U+044F
+                unsigned code = 0x0430 + random() % 32;
+                words[i] += static_cast<char>(0xC0 | (code >> 6));
+                words[i] += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                words[i] += static_cast<char>('a' + random() % 26);
             }
         }
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
 
-        // Сортировка вектора по убыванию частоты
-        std::sort(sortedWords.begin(), sortedWords.end(),
-            [](const auto& a, const auto& b) {
-                return a.second > b.second;
-            });
-
-        // Вывод отсортированных слов и их частоты в требуемом формате
-        for (const auto& pair : sortedWords) {
-            // Выравнивание по левому краю для слова и по правому для числа
-            std::cout << std::left << std::setw(10) << pair.first
-                << std::right << std::setw(5) << pair.second
-                << std::endl;
+    std::string text;
+    text.reserve(bytes + 64);
+    size_t column = 0;
+    while (text.size() < bytes) {
+        size_t i = pick(random);
+        std::string word = words[i];
+        double style = chance(random);
+        if (style < 0.10) {
+            // Заглавная первая буква: латиница - сдвиг на 32, кириллица а..п и р..я - по-разному
+            if (cyrillic[i]) {
+                unsigned code = ((static_cast<unsigned char>(word[0]) & 0x1F) << 6) | (static_cast<unsigned char>(word[1]) & 0x3F);
+                code -= 0x20;
+                word[0] = static_cast<char>(0xC0 | (code >> 6));
+                word[1] = static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                word[0] = static_cast<char>(word[0] - 32);
+            }
         }
+        else if (style < 0.13) {
+            word = "\"" + word + "\"";
+        }
+        text += word;
+        column += word.size();
+        double separator = chance(random);
+        if (column > 70) {
+            text += '\n';
+            column = 0;
+        }
+        else {
+            text += separator < 0.85 ? ' ' : separator < 0.93 ? ',' : '.';
+        }
+    }
+    return text;
+}
+
+// Временный файл с текстом для замеров, удаляется вместе с объектом
+class BenchFile {
+private:
+    std::string path;
+
+public:
+    BenchFile(const std::string& name, const std::string& text) : path(name) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
     }
+
+    BenchFile(const BenchFile&) = delete;
+    BenchFile& operator=(const BenchFile&) = delete;
+
+    ~BenchFile() { std::remove(path.c_str()); }
+
+    const std::string& name() const { return path; }
 };
 
+// Размер файла в мегабайтах
+double fileMegabytes(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return static_cast<double>(file.tellg()) / 1e6;
+}
+
+// Таблица WordTable против прежнего подсчета через std::map
+void benchmarkWordTable(const std::string& corpus) {
+    double megabytes = fileMegabytes(corpus);
+    std::cout << "Подсчет слов, " << megabytes << " МБ:" << std::endl;
+
+    MapWordCounter old;
+    double oldSeconds = elapsedSeconds([&] { old.processFile(corpus); });
+    std::cout << "  std::map (прежний путь)  " << std::setw(8) << megabytes / oldSeconds << " МБ/с, слов "
+        << old.frequencies().size() << std::endl;
+
+    WordFrequencyCounter counter;
+    double seconds = elapsedSeconds([&] { counter.processFile(corpus); });
+    WordList all = counter.query(WordQuery(1));
+    // Частоты сравниваются только для ASCII: прежний путь не разбирает UTF-8
+    bool same = all.size() == old.frequencies().size();
+    for (const WordTable::Entry* entry : all) {
+        auto found = old.frequencies().find(std::string(entry->word, entry->length));
+        same = same && found != old.frequencies().end() && found->second == entry->count;
+    }
+    std::cout << "  WordTable                " << std::setw(8) << megabytes / seconds << " МБ/с, слов "
+        << all.size() << ", частоты " << (same ? "совпадают" : "различаются") << std::endl;
+}
+
+// Частоты всех слов подсчета в виде пар (слово, частота) в порядке выборки
+std::vector<std::pair<std::string, int>> allFrequencies(WordFrequencyCounter& counter) {
+    std::vector<std::pair<std::string, int>> result;
+    for (const WordTable::Entry* entry : counter.query(WordQuery(1))) {
+        result.emplace_back(std::string(entry->word, entry->length), entry->count);
+    }
+    return result;
+}
+
+// Масштабирование processFileParallel: 1, 2, 4... потоков до числа ядер (не меньше 4).
+// Результат каждого прогона сверяется с однопоточным
+void benchmarkParallel(const std::string& corpus) {
+    double megabytes = fileMegabytes(corpus);
+    size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::cout << "Параллельный подсчет, ядер " << cores << ":" << std::endl;
+
+    std::vector<std::pair<std::string, int>> reference;
+    double baseSeconds = 0.0;
+    for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2) {
+        WordFrequencyCounter counter;
+        double seconds = elapsedSeconds([&] { counter.processFileParallel(corpus, threads); });
+        if (threads == 1) {
+            reference = allFrequencies(counter);
+            baseSeconds = seconds;
+        }
+        bool same = allFrequencies(counter) == reference;
+        std::cout << "  потоков " << std::setw(3) << threads << "  " << std::setw(8) << megabytes / seconds
+            << " МБ/с, ускорение " << std::setw(4) << baseSeconds / seconds << "x, результат "
+            << (same ? "совпадает" : "различается") << std::endl;
+    }
+}
+
+// Приближенный подсчет против точного: доля верно найденных слов среди K самых частых,
+// ошибка оценок частоты и занимаемая память
+void benchmarkApproximate(const std::string& corpus) {
+    const size_t TOP = 100;
+    std::cout << "Приближенный подсчет, " << TOP << " самых частых слов:" << std::endl;
+
+    WordFrequencyCounter exact;
+    double exactSeconds = elapsedSeconds([&] { exact.processFile(corpus); });
+    std::map<std::string, int> counts;
+    long long total = 0;
+    for (const WordTable::Entry* entry : exact.query(WordQuery(1))) {
+        counts[std::string(entry->word, entry->length)] = entry->count;
+        total += entry->count;
+    }
+    std::vector<std::pair<std::string, int>> exactTop = allFrequencies(exact);
+    exactTop.resize(std::min(TOP, exactTop.size()));
+    std::cout << "  точный        " << std::setw(8) << fileMegabytes(corpus) / exactSeconds << " МБ/с, память "
+        << std::setw(8) << exact.memoryUsage() / 1024.0 << " КБ" << std::endl;
+
+    for (size_t hitters : { size_t(256), size_t(1024), size_t(4096) }) {
+        WordFrequencyCounter approximate(WordSketch::Limits(1e-4, 1e-3, hitters));
+        double seconds = elapsedSeconds([&] { approximate.processFile(corpus); });
+
+        // Найденные слова из точного top-K
+        size_t found = 0;
+        for (const WordTable::Entry* entry : approximate.query(WordQuery(1, TOP))) {
+            std::string word(entry->word, entry->length);
+            for (const auto& item : exactTop) {
+                if (item.first == word) {
+                    ++found;
+                    break;
+                }
+            }
+        }
+
+        // Ошибка оценок по всем отслеживаемым словам относительно общего числа слов
+        double maxError = 0.0;
+        double sumError = 0.0;
+        WordList tracked = approximate.query(WordQuery(1));
+        for (const WordTable::Entry* entry : tracked) {
+            auto exactCount = counts.find(std::string(entry->word, entry->length));
+            double error = static_cast<double>(entry->count - (exactCount == counts.end() ? 0 : exactCount->second));
+            maxError = std::max(maxError, error);
+            sumError += error;
+        }
+        std::cout << "  hitters " << std::setw(5) << hitters << " " << std::setw(8) << fileMegabytes(corpus) / seconds
+            << " МБ/с, память " << std::setw(8) << approximate.memoryUsage() / 1024.0 << " КБ, найдено "
+            << std::setw(5) << 100.0 * found / exactTop.size() << "%, ошибка частоты средняя "
+            << std::setw(6) << (tracked.empty() ? 0.0 : 1e6 * sumError / tracked.size() / total) << " ppm, наибольшая "
+            << std::setw(6) << 1e6 * maxError / total << " ppm" << std::endl;
+    }
+}
+
+// Перевод кириллицы (А..я, U+0410..U+044F) из UTF-8 в CP1251, остальные байты не меняются
+std::string toCp1251(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        if ((lead == 0xD0 || lead == 0xD1) && i + 1 < text.size()) {
+            unsigned code = ((lead & 0x1F) << 6) | (static_cast<unsigned char>(text[i + 1]) & 0x3F);
+            if (code >= 0x0410 && code <= 0x044F) {
+                result += static_cast<char>(0xC0 + (code - 0x0410));
+                ++i;
+                continue;
+            }
+        }
+        result += text[i];
+    }
+    return result;
+}
+
+// Скорость подсчета для текста только из ASCII и для смеси латиницы с кириллицей
+// в UTF-8 и в CP1251
+void benchmarkEncodings() {
+    const size_t BYTES = 16000000;
+    std::cout << "Кодировки текста:" << std::endl;
+
+    struct Case {
+        const char* name;
+        std::string text;
+        WordFrequencyCounter::Encoding encoding;
+    };
+    std::string mixed = makeCorpus(BYTES, 50000, 0.5, 2);
+    Case cases[] = {
+        { "ASCII, UTF8", makeCorpus(BYTES, 50000, 0.0, 2), WordFrequencyCounter::UTF8 },
+        { "латиница и кириллица, UTF8", mixed, WordFrequencyCounter::UTF8 },
+        { "латиница и кириллица в CP1251, SINGLE_BYTE", toCp1251(mixed), WordFrequencyCounter::SINGLE_BYTE },
+    };
+    for (const Case& item : cases) {
+        BenchFile file("wfc_bench_encoding.txt", item.text);
+        WordFrequencyCounter counter;
+        counter.setEncoding(item.encoding);
+        double seconds = elapsedSeconds([&] { counter.processFile(file.name()); });
+        std::cout << "  " << std::setw(8) << fileMegabytes(file.name()) / seconds << " МБ/с - " << item.name << std::endl;
+    }
+}
+
+// Все замеры режима --bench. Без файла используется синтетический текст
+void runBenchmarks(const std::string& filename) {
+    std::cout << std::fixed << std::setprecision(1);
+    std::unique_ptr<BenchFile> generated;
+    std::string corpus = filename;
+    if (corpus.empty()) {
+        generated.reset(new BenchFile("wfc_bench_ascii.txt", makeCorpus(64000000, 200000, 0.0, 1)));
+        corpus = generated->name();
+    }
+
+    benchmarkWordTable(corpus);
+    benchmarkParallel(corpus);
+    benchmarkApproximate(corpus);
+    benchmarkEncodings();
+}
+
 // Главная функция - точка входа в программу
-int main() {
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "Russian");
+
+    // Самопроверки или замеры производительности вместо обработки файла
+    if (argc > 1 && std::string(argv[1]) == "--selftest") {
+        return runSelfTests() ? 0 : 1;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmarks(argc > 2 ? argv[2] : "");
+        return 0;
+    }
+
     // Создание экземпляра класса для подсчета частоты слов
     WordFrequencyCounter counter;
 
-    // Обработка текстового файла
-    counter.processFile("input.txt");
+    // Обработка текстового файла: имя из командной строки ("-" - стандартный ввод),
+    // по умолчанию input.txt
+    counter.processFile(argc > 1 ? argv[1] : "input.txt");
 
     // Вывод слов, встречающихся не менее 7 раз
     counter.printFrequentWords();
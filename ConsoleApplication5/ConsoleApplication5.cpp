@@ -3,19 +3,753 @@
 #include <string>
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <memory>
+#include <exception>
+#include <utility>
+#include <iomanip>
+#include <random>
+#include <atomic>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CACHE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
-// Основной шаблонный класс кэша
-template <typename T>
-class Cache {
+// Индекс элементов с открытой адресацией по схеме Swiss table. Для каждой ячейки хранится
+// управляющий байт: 7 бит хеша занятой ячейки либо признак пустой или удаленной ячейки.
+// Ячейки проверяются группами по 16: управляющие байты группы сравниваются с хешем
+// одной командой SSE2, и ключи сравниваются только у совпавших ячеек.
+// Сами элементы хранятся снаружи, в ячейке - только их номер; keyOf(номер) возвращает элемент
+template <typename Key, typename Hash = std::hash<Key>>
+class HashIndex {
+public:
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+private:
+    static const size_t GROUP = 16;
+    static const int8_t EMPTY = -128;
+    static const int8_t DELETED = -2;
+
+    std::vector<int8_t> control;    // Управляющие байты, количество кратно GROUP
+    std::vector<uint32_t> slots;    // Номера элементов
+    size_t groupMask = 0;           // Количество групп - 1 (количество групп - степень двойки)
+    size_t occupied = 0;            // Занятые и удаленные ячейки
+    size_t live = 0;                // Занятые ячейки
+    Hash hasher;
+
+    // Маска ячеек группы с управляющим байтом value
+    static uint32_t match(const int8_t* group, int8_t value) {
+#ifdef CACHE_SSE2
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            mask |= static_cast<uint32_t>(group[i] == value) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static unsigned lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Запись номера в первую свободную ячейку на пути поиска
+    void place(uint64_t hash, uint32_t index) {
+        size_t g = (hash >> 7) & groupMask;
+        for (size_t step = 1;; ++step) {
+            const int8_t* group = &control[g * GROUP];
+            uint32_t free = match(group, EMPTY) | match(group, DELETED);
+            if (free != 0) {
+                size_t pos = g * GROUP + lowestBit(free);
+                if (control[pos] == EMPTY) ++occupied;
+                ++live;
+                control[pos] = static_cast<int8_t>(hash & 0x7F);
+                slots[pos] = index;
+                return;
+            }
+            g = (g + step) & groupMask;
+        }
+    }
+
+    // Перестроение с заданным количеством групп; удаленные ячейки при этом освобождаются
+    template <typename KeyOf>
+    void rehash(size_t groups, KeyOf keyOf) {
+        std::vector<int8_t> oldControl(groups * GROUP, EMPTY);
+        std::vector<uint32_t> oldSlots(groups * GROUP);
+        oldControl.swap(control);
+        oldSlots.swap(slots);
+        groupMask = groups - 1;
+        occupied = 0;
+        live = 0;
+        for (size_t pos = 0; pos < oldControl.size(); ++pos) {
+            if (oldControl[pos] >= 0) {
+                place(hashOf(keyOf(oldSlots[pos])), oldSlots[pos]);
+            }
+        }
+    }
+
+    // Ячейка элемента, равного key, либо control.size()
+    template <typename KeyOf>
+    size_t position(const Key& key, KeyOf keyOf) const {
+        if (control.empty()) return 0;
+        uint64_t hash = hashOf(key);
+        int8_t tag = static_cast<int8_t>(hash & 0x7F);
+        size_t g = (hash >> 7) & groupMask;
+        for (size_t step = 1;; ++step) {
+            const int8_t* group = &control[g * GROUP];
+            for (uint32_t candidates = match(group, tag); candidates != 0; candidates &= candidates - 1) {
+                size_t pos = g * GROUP + lowestBit(candidates);
+                if (keyOf(slots[pos]) == key) return pos;
+            }
+            // Пустая ячейка в группе означает конец цепочки проб
+            if (match(group, EMPTY) != 0) return control.size();
+            g = (g + step) & groupMask;
+        }
+    }
+
+public:
+    // Перемешивание хеша: стандартный хеш целых чисел часто совпадает с самим числом
+    uint64_t hashOf(const Key& key) const {
+        uint64_t hash = static_cast<uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 29);
+    }
+
+    // Номер элемента, равного key, либо NOT_FOUND
+    template <typename KeyOf>
+    uint32_t find(const Key& key, KeyOf keyOf) const {
+        size_t pos = position(key, keyOf);
+        return pos < control.size() ? slots[pos] : NOT_FOUND;
+    }
+
+    // Удаление элемента key из индекса; ячейка помечается удаленной, чтобы не разрывать цепочки проб
+    template <typename KeyOf>
+    void erase(const Key& key, KeyOf keyOf) {
+        size_t pos = position(key, keyOf);
+        if (pos < control.size()) {
+            control[pos] = DELETED;
+            --live;
+        }
+    }
+
+    // Добавление номера элемента key (элемента еще нет в индексе).
+    // Заполнение, включая удаленные ячейки, не превышает 7/8; если больше половины
+    // ячеек свободно или удалено, индекс перестраивается без увеличения
+    template <typename KeyOf>
+    void insert(const Key& key, uint32_t index, KeyOf keyOf) {
+        if ((occupied + 1) * 8 > control.size() * 7) {
+            size_t groups = control.empty() ? 1 : groupMask + 1;
+            if ((live + 1) * 2 > control.size()) groups *= 2;
+            rehash(groups, keyOf);
+        }
+        place(hashOf(key), index);
+    }
+
+    // Объем памяти в байтах
+    size_t memoryUsage() const { return control.capacity() + slots.capacity() * sizeof(uint32_t); }
+};
+
+template <typename Key, typename Hash> const uint32_t HashIndex<Key, Hash>::NOT_FOUND;
+template <typename Key, typename Hash> const size_t HashIndex<Key, Hash>::GROUP;
+template <typename Key, typename Hash> const int8_t HashIndex<Key, Hash>::EMPTY;
+template <typename Key, typename Hash> const int8_t HashIndex<Key, Hash>::DELETED;
+
+// Счетчики обращений к кэшу
+struct CacheStats {
+    uint64_t hits = 0;        // Элемент найден
+    uint64_t misses = 0;      // Элемента не было
+    uint64_t evictions = 0;   // Элементы, вытесненные ради новых
+};
+
+// Двусвязные списки ячеек кэша на общих массивах ссылок: каждая ячейка
+// состоит не более чем в одном списке, голова списка list - ячейка slots + list
+class SlotLinks {
+private:
+    std::vector<uint32_t> prev;
+    std::vector<uint32_t> next;
+    std::vector<size_t> sizes;
+    uint32_t slots = 0;
+
+public:
+    void reset(size_t slotCount, size_t listCount) {
+        slots = static_cast<uint32_t>(slotCount);
+        prev.resize(slotCount + listCount);
+        next.resize(slotCount + listCount);
+        for (uint32_t head = slots; head < slots + listCount; ++head) {
+            prev[head] = head;
+            next[head] = head;
+        }
+        sizes.assign(listCount, 0);
+    }
+
+    void pushFront(size_t list, uint32_t slot) {
+        uint32_t head = slots + static_cast<uint32_t>(list);
+        next[slot] = next[head];
+        prev[slot] = head;
+        prev[next[head]] = slot;
+        next[head] = slot;
+        ++sizes[list];
+    }
+
+    void remove(size_t list, uint32_t slot) {
+        next[prev[slot]] = next[slot];
+        prev[next[slot]] = prev[slot];
+        --sizes[list];
+    }
+
+    // Последняя (давнее всех использованная) ячейка списка
+    uint32_t back(size_t list) const { return prev[slots + list]; }
+
+    size_t size(size_t list) const { return sizes[list]; }
+};
+
+// Политики вытеснения работают с номерами ячеек 0..capacity-1:
+//   reset(capacity)        - начальное состояние;
+//   onInsert(slot, hash)   - в ячейку записан новый элемент;
+//   onAccess(slot, hash)   - элемент ячейки найден;
+//   onMiss(hash)           - элемента нет в кэше;
+//   onRemove(slot)         - элемент ячейки удален без вытеснения (ячейка будет занята заново);
+//   evict()                - ячейка, элемент которой нужно вытеснить (кэш заполнен).
+// BOUNDED - ограничена ли емкость, NEEDS_HASH - нужен ли политике хеш элемента
+
+// Без вытеснения: кэш растет неограниченно
+struct NoEviction {
+    static const bool BOUNDED = false;
+    static const bool NEEDS_HASH = false;
+
+    void reset(size_t) {}
+    void onInsert(uint32_t, uint64_t) {}
+    void onAccess(uint32_t, uint64_t) {}
+    void onMiss(uint64_t) {}
+    void onRemove(uint32_t) {}
+    uint32_t evict() { return 0; }
+};
+
+// Вытеснение давнее всех использованного элемента (LRU)
+class LruEviction {
+private:
+    SlotLinks links;
+
+public:
+    static const bool BOUNDED = true;
+    static const bool NEEDS_HASH = false;
+
+    void reset(size_t capacity) { links.reset(capacity, 1); }
+    void onInsert(uint32_t slot, uint64_t) { links.pushFront(0, slot); }
+    void onAccess(uint32_t slot, uint64_t) {
+        links.remove(0, slot);
+        links.pushFront(0, slot);
+    }
+    void onMiss(uint64_t) {}
+    void onRemove(uint32_t slot) { links.remove(0, slot); }
+    uint32_t evict() {
+        uint32_t victim = links.back(0);
+        links.remove(0, victim);
+        return victim;
+    }
+};
+
+// Алгоритм CLOCK: стрелка обходит ячейки по кругу, элемент с признаком обращения
+// получает второй шанс (признак сбрасывается), первый элемент без признака вытесняется
+class ClockEviction {
+private:
+    std::vector<uint8_t> referenced;
+    uint32_t hand = 0;
+
+public:
+    static const bool BOUNDED = true;
+    static const bool NEEDS_HASH = false;
+
+    void reset(size_t capacity) {
+        referenced.assign(capacity, 0);
+        hand = 0;
+    }
+    void onInsert(uint32_t slot, uint64_t) { referenced[slot] = 0; }
+    void onAccess(uint32_t slot, uint64_t) { referenced[slot] = 1; }
+    void onMiss(uint64_t) {}
+    void onRemove(uint32_t slot) { referenced[slot] = 0; }
+    uint32_t evict() {
+        while (referenced[hand]) {
+            referenced[hand] = 0;
+            hand = (hand + 1) % referenced.size();
+        }
+        uint32_t victim = hand;
+        hand = (hand + 1) % referenced.size();
+        return victim;
+    }
+};
+
+// Приближенные частоты обращений для W-TinyLFU: 4 строки 4-битных счетчиков
+// (хранятся в байтах). Каждые 10 * capacity обращений счетчики делятся пополам,
+// чтобы старая популярность со временем забывалась
+class FrequencySketch {
+private:
+    static const size_t ROWS = 4;
+
+    std::vector<uint8_t> counters;
+    size_t width = 0;
+    size_t additions = 0;
+    size_t sampleSize = 0;
+
+    size_t cell(size_t row, uint64_t hash) const {
+        uint64_t step = (hash >> 32) | 1;
+        return row * width + static_cast<size_t>((hash + row * step) & (width - 1));
+    }
+
+public:
+    void reset(size_t capacity) {
+        width = 16;
+        while (width < capacity) width <<= 1;
+        counters.assign(ROWS * width, 0);
+        additions = 0;
+        sampleSize = 10 * std::max<size_t>(capacity, 1);
+    }
+
+    void increment(uint64_t hash) {
+        for (size_t row = 0; row < ROWS; ++row) {
+            uint8_t& counter = counters[cell(row, hash)];
+            if (counter < 15) ++counter;
+        }
+        if (++additions >= sampleSize) {
+            for (uint8_t& counter : counters) counter >>= 1;
+            additions /= 2;
+        }
+    }
+
+    unsigned frequency(uint64_t hash) const {
+        unsigned result = 15;
+        for (size_t row = 0; row < ROWS; ++row) {
+            result = std::min<unsigned>(result, counters[cell(row, hash)]);
+        }
+        return result;
+    }
+};
+
+// W-TinyLFU: новые элементы попадают в небольшое окно LRU (1% емкости), основная часть -
+// сегментированный LRU (испытательный и защищенный списки, защищенный - 80% основной части).
+// При вытеснении кандидат из окна сравнивается по частоте с жертвой из испытательного
+// списка, и остается тот, к кому обращались чаще
+class TinyLfuEviction {
 private:
-    std::vector<T> data; // Контейнер для хранения элементов
+    enum List : uint8_t { WINDOW, PROBATION, PROTECTED };
+
+    SlotLinks links;
+    std::vector<uint8_t> listOf;
+    std::vector<uint64_t> hashes;
+    FrequencySketch sketch;
+    size_t windowCapacity = 0;
+    size_t protectedCapacity = 0;
+
+    void move(uint32_t slot, List to) {
+        links.remove(listOf[slot], slot);
+        links.pushFront(to, slot);
+        listOf[slot] = to;
+    }
+
+public:
+    static const bool BOUNDED = true;
+    static const bool NEEDS_HASH = true;
+
+    void reset(size_t capacity) {
+        links.reset(capacity, 3);
+        listOf.assign(capacity, WINDOW);
+        hashes.assign(capacity, 0);
+        sketch.reset(capacity);
+        windowCapacity = std::max<size_t>(1, capacity / 100);
+        protectedCapacity = (capacity - windowCapacity) * 8 / 10;
+    }
+
+    void onInsert(uint32_t slot, uint64_t hash) {
+        hashes[slot] = hash;
+        listOf[slot] = WINDOW;
+        links.pushFront(WINDOW, slot);
+        // Пока кэш не заполнен, вышедшие из окна элементы переходят в основную часть без отбора
+        if (links.size(WINDOW) > windowCapacity) {
+            move(links.back(WINDOW), PROBATION);
+        }
+    }
+
+    void onAccess(uint32_t slot, uint64_t hash) {
+        sketch.increment(hash);
+        if (listOf[slot] == PROBATION) {
+            move(slot, PROTECTED);
+            if (links.size(PROTECTED) > protectedCapacity) {
+                move(links.back(PROTECTED), PROBATION);
+            }
+        }
+        else {
+            move(slot, static_cast<List>(listOf[slot]));
+        }
+    }
+
+    void onMiss(uint64_t hash) { sketch.increment(hash); }
+
+    void onRemove(uint32_t slot) { links.remove(listOf[slot], slot); }
+
+    uint32_t evict() {
+        uint32_t candidate = links.back(WINDOW);
+        List mainList = links.size(PROBATION) > 0 ? PROBATION : PROTECTED;
+        if (links.size(mainList) == 0) {
+            links.remove(WINDOW, candidate);
+            return candidate;
+        }
+        uint32_t victim = links.back(mainList);
+        if (sketch.frequency(hashes[candidate]) > sketch.frequency(hashes[victim])) {
+            links.remove(mainList, victim);
+            move(candidate, PROBATION);
+            return victim;
+        }
+        links.remove(WINDOW, candidate);
+        return candidate;
+    }
+};
+
+// Общая часть кэшей: ключи в плотном массиве ячеек, индекс по ним и политика вытеснения
+// (NoEviction, LruEviction, ClockEviction, TinyLfuEviction). При ограниченной емкости
+// новый ключ занимает ячейку вытесненного, поэтому все операции выполняются за O(1)
+template <typename Key, typename Eviction, typename Hash>
+class CacheStorage {
+protected:
+    static const uint32_t NOT_FOUND = HashIndex<Key, Hash>::NOT_FOUND;
+
+    // Пока элементов не больше SMALL_SIZE, они ищутся простым перебором
+    static const size_t SMALL_SIZE = 8;
+
+    std::vector<Key> data; // Контейнер для хранения элементов
+    HashIndex<Key, Hash> index; // Индекс по элементам, строится после SMALL_SIZE элементов
+    size_t limit; // Емкость (0 - без ограничения)
+
+    // Учет обращений не меняет содержимое кэша, поэтому доступен и в константных методах
+    mutable Eviction eviction;
+    mutable CacheStats counters;
+
+    uint64_t hashFor(const Key& key) const { return Eviction::NEEDS_HASH ? index.hashOf(key) : 0; }
+
+    // Номер ячейки ключа либо NOT_FOUND
+    uint32_t locate(const Key& key) const {
+        if (data.size() <= SMALL_SIZE) {
+            // Используем std::find для поиска элемента
+            auto found = std::find(data.begin(), data.end(), key);
+            return found != data.end() ? static_cast<uint32_t>(found - data.begin()) : NOT_FOUND;
+        }
+        return index.find(key, [this](uint32_t i) -> const Key& { return data[i]; });
+    }
+
+    // Учет обращения к ключу: попадание в ячейку slot либо промах (slot == NOT_FOUND)
+    void record(const Key& key, uint32_t slot) const {
+        uint64_t hash = hashFor(key);
+        if (slot == NOT_FOUND) {
+            ++counters.misses;
+            eviction.onMiss(hash);
+        }
+        else {
+            ++counters.hits;
+            eviction.onAccess(slot, hash);
+        }
+    }
+
+    // Поиск ключа с учетом обращения
+    uint32_t access(const Key& key) const {
+        uint32_t slot = locate(key);
+        record(key, slot);
+        return slot;
+    }
+
+    // Замена ключа занятой ячейки slot на key в массиве и индексе
+    void replaceKey(uint32_t slot, const Key& key) {
+        auto keyOf = [this](uint32_t i) -> const Key& { return data[i]; };
+        if (data.size() > SMALL_SIZE) index.erase(data[slot], keyOf);
+        data[slot] = key;
+        if (data.size() > SMALL_SIZE) index.insert(data[slot], slot, keyOf);
+    }
+
+    // Ячейка slot занимается новым ключом без вытеснения (например, прежнее значение устарело)
+    void reuse(uint32_t slot, const Key& key) {
+        eviction.onRemove(slot);
+        replaceKey(slot, key);
+        eviction.onInsert(slot, hashFor(key));
+    }
+
+    // Ячейка для нового ключа: следующая свободная либо ячейка вытесненного ключа
+    uint32_t allocate(const Key& key) {
+        auto keyOf = [this](uint32_t i) -> const Key& { return data[i]; };
+        uint32_t slot;
+        if (limit != 0 && data.size() >= limit) {
+            slot = eviction.evict();
+            ++counters.evictions;
+            replaceKey(slot, key);
+        }
+        else {
+            data.push_back(key);
+            slot = static_cast<uint32_t>(data.size() - 1);
+            if (data.size() == SMALL_SIZE + 1) {
+                for (size_t i = 0; i < data.size(); ++i) {
+                    index.insert(data[i], static_cast<uint32_t>(i), keyOf);
+                }
+            }
+            else if (data.size() > SMALL_SIZE) {
+                index.insert(data.back(), slot, keyOf);
+            }
+        }
+        eviction.onInsert(slot, hashFor(key));
+        return slot;
+    }
+
+    // capacity - наибольшее количество элементов; для кэша без вытеснения не используется
+    explicit CacheStorage(size_t capacity) : limit(Eviction::BOUNDED ? capacity : 0) {
+        if (Eviction::BOUNDED && capacity == 0) {
+            throw std::invalid_argument("Емкость кэша с вытеснением должна быть больше нуля");
+        }
+        eviction.reset(limit);
+        data.reserve(limit);
+    }
 
 public:
+    // Количество элементов
+    size_t size() const { return data.size(); }
+
+    // Емкость (0 - без ограничения)
+    size_t capacity() const { return limit; }
+
+    // Счетчики попаданий, промахов и вытеснений
+    CacheStats stats() const { return counters; }
+};
+
+template <typename Key, typename Eviction, typename Hash> const uint32_t CacheStorage<Key, Eviction, Hash>::NOT_FOUND;
+template <typename Key, typename Eviction, typename Hash> const size_t CacheStorage<Key, Eviction, Hash>::SMALL_SIZE;
+
+// Основной шаблонный класс кэша: Cache<K, V> хранит значения по ключам, Cache<T> (V = void) -
+// только наличие элементов. Значение может устаревать через ttl после записи; ячейки
+// устаревших значений занимаются новыми ключами раньше свободных и вытесняемых ячеек.
+// Кэш значений защищен мьютексом: getOrCompute при одновременных промахах по одному ключу
+// вызывает загрузчик один раз, остальные потоки ждут и получают тот же результат
+template <typename Key, typename Value = void, typename Eviction = NoEviction, typename Hash = std::hash<Key>>
+class Cache : public CacheStorage<Key, Eviction, Hash> {
+private:
+    typedef CacheStorage<Key, Eviction, Hash> Storage;
+    typedef std::chrono::steady_clock Clock;
+
+    // Загрузка значения, которую ждут другие потоки
+    struct Flight {
+        std::condition_variable done;
+        bool ready = false;
+        std::unique_ptr<Value> value;
+        std::exception_ptr error;
+    };
+
+    std::vector<Value> values; // Значения по ячейкам ключей
+    std::vector<Clock::time_point> expires; // Момент устаревания значений
+    Clock::duration ttl; // Время жизни значения (0 - не устаревает)
+    std::unordered_map<Key, std::shared_ptr<Flight>, Hash> flights; // Идущие загрузки
+    mutable std::mutex lock;
+
+    // Найденные ячейки устаревших значений; ключ такой ячейки может быть записан заново,
+    // поэтому перед повторным использованием ячейка проверяется еще раз
+    mutable std::vector<uint32_t> expired;
+    mutable std::vector<uint8_t> listed; // Ячейка есть в expired
+    size_t sweep = 0; // Следующая ячейка для поиска устаревших значений
+
+    bool fresh(uint32_t slot) const {
+        return ttl == Clock::duration::zero() || Clock::now() < expires[slot];
+    }
+
+    void noteExpired(uint32_t slot) const {
+        if (!listed[slot]) {
+            listed[slot] = 1;
+            expired.push_back(slot);
+        }
+    }
+
+    // Ячейка устаревшего значения для нового ключа либо NOT_FOUND. При каждом добавлении
+    // проверяются еще две ячейки по кругу, поэтому устаревшие значения ключей, к которым
+    // больше не обращаются, тоже со временем находятся и их ячейки занимаются заново
+    uint32_t takeExpired() {
+        if (ttl == Clock::duration::zero() || values.empty()) return Storage::NOT_FOUND;
+        for (int i = 0; i < 2; ++i) {
+            sweep = sweep + 1 < values.size() ? sweep + 1 : 0;
+            if (!fresh(static_cast<uint32_t>(sweep))) noteExpired(static_cast<uint32_t>(sweep));
+        }
+        while (!expired.empty()) {
+            uint32_t slot = expired.back();
+            expired.pop_back();
+            listed[slot] = 0;
+            if (!fresh(slot)) return slot;
+        }
+        return Storage::NOT_FOUND;
+    }
+
+    // Ячейка действующего значения ключа либо NOT_FOUND, с учетом обращения
+    uint32_t lookup(const Key& key) const {
+        uint32_t slot = this->locate(key);
+        if (slot != Storage::NOT_FOUND && !fresh(slot)) {
+            noteExpired(slot);
+            slot = Storage::NOT_FOUND;
+        }
+        this->record(key, slot);
+        return slot;
+    }
+
+    // Запись значения в ячейку ключа slot (NOT_FOUND - ключа нет в кэше);
+    // устаревшее значение ключа заменяется в той же ячейке, новый ключ занимает
+    // ячейку устаревшего значения, если такая найдена
+    void store(const Key& key, const Value& value, uint32_t slot) {
+        if (slot == Storage::NOT_FOUND) {
+            slot = takeExpired();
+            if (slot != Storage::NOT_FOUND) {
+                this->reuse(slot, key);
+            }
+            else {
+                slot = this->allocate(key);
+            }
+        }
+        if (slot == values.size()) {
+            values.push_back(value);
+            expires.push_back(Clock::now() + ttl);
+            listed.push_back(0);
+        }
+        else {
+            values[slot] = value;
+            expires[slot] = Clock::now() + ttl;
+        }
+    }
+
+public:
+    // capacity - наибольшее количество элементов (для кэша с вытеснением),
+    // ttl - время жизни значения (0 - значения не устаревают)
+    explicit Cache(size_t capacity = 0, std::chrono::milliseconds ttl = std::chrono::milliseconds::zero())
+        : Storage(capacity), ttl(ttl) {
+    }
+
+    // Метод добавления значения в кэш. Перезапись устаревшего значения учитывается
+    // как промах, как и при чтении; значение записывается в прежнюю ячейку ключа
+    void put(const Key& key, const Value& value) {
+        std::lock_guard<std::mutex> guard(lock);
+        lookup(key);
+        store(key, value, this->locate(key));
+    }
+
+    // Перегрузка оператора += для добавления пары "ключ, значение"
+    Cache& operator+=(const std::pair<Key, Value>& entry) {
+        put(entry.first, entry.second);
+        return *this;
+    }
+
+    // Метод проверки наличия действующего значения
+    bool contains(const Key& key) const {
+        std::lock_guard<std::mutex> guard(lock);
+        return lookup(key) != Storage::NOT_FOUND;
+    }
+
+    // Чтение значения; false - если значения нет или оно устарело
+    bool get(const Key& key, Value& value) const {
+        std::lock_guard<std::mutex> guard(lock);
+        uint32_t slot = lookup(key);
+        if (slot == Storage::NOT_FOUND) {
+            return false;
+        }
+        value = values[slot];
+        return true;
+    }
+
+    // Значение из кэша либо результат loader(key), который сохраняется в кэше.
+    // Исключение загрузчика передается всем ожидавшим потокам, значение при этом не сохраняется
+    template <typename Loader>
+    Value getOrCompute(const Key& key, Loader loader) {
+        std::unique_lock<std::mutex> guard(lock);
+        uint32_t slot = lookup(key);
+        if (slot != Storage::NOT_FOUND) {
+            return values[slot];
+        }
+
+        // Этот ключ уже загружает другой поток - ждем его результат
+        auto running = flights.find(key);
+        if (running != flights.end()) {
+            std::shared_ptr<Flight> flight = running->second;
+            flight->done.wait(guard, [&flight] { return flight->ready; });
+            if (flight->error) {
+                std::rethrow_exception(flight->error);
+            }
+            return *flight->value;
+        }
+
+        std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+        flights.emplace(key, flight);
+        guard.unlock();
+        try {
+            std::unique_ptr<Value> value(new Value(loader(key)));
+            guard.lock();
+            store(key, *value, this->locate(key));
+            flight->value = std::move(value);
+        }
+        catch (...) {
+            if (!guard.owns_lock()) guard.lock();
+            flight->error = std::current_exception();
+        }
+        flight->ready = true;
+        flights.erase(key);
+        flight->done.notify_all();
+        if (flight->error) {
+            std::rethrow_exception(flight->error);
+        }
+        return *flight->value;
+    }
+
+    // Количество занятых ячеек, включая устаревшие значения, ячейки которых еще не заняты заново
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return Storage::size();
+    }
+
+    // Количество действующих значений; ячейки просматриваются все, O(size())
+    size_t liveSize() const {
+        std::lock_guard<std::mutex> guard(lock);
+        size_t live = 0;
+        for (uint32_t slot = 0; slot < values.size(); ++slot) {
+            live += fresh(slot);
+        }
+        return live;
+    }
+
+    // Счетчики попаданий, промахов и вытеснений
+    CacheStats stats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return Storage::stats();
+    }
+};
+
+// Кэш наличия элементов
+template <typename T, typename Eviction, typename Hash>
+class Cache<T, void, Eviction, Hash> : public CacheStorage<T, Eviction, Hash> {
+private:
+    typedef CacheStorage<T, Eviction, Hash> Storage;
+
+public:
+    // capacity - наибольшее количество элементов; для кэша без вытеснения не используется
+    explicit Cache(size_t capacity = 0) : Storage(capacity) {}
+
     // Метод добавления элемента в кэш
     void put(T elem) {
         // Добавляем элемент, если его еще нет в кэше
-        if (!contains(elem)) {
-            data.push_back(elem);
+        if (this->access(elem) == Storage::NOT_FOUND) {
+            this->allocate(elem);
         }
     }
 
@@ -25,27 +759,222 @@ public:
         return *this;
     }
 
-    // Метод проверки наличия элемента в кэше
+    // Метод проверки наличия элемента в кэше; обращение учитывается политикой вытеснения
     bool contains(T elem) const {
-        // Используем std::find для поиска элемента
-        return std::find(data.begin(), data.end(), elem) != data.end();
+        return this->access(elem) != Storage::NOT_FOUND;
     }
 };
 
-// Явная специализация для std::string
+// Кэш наличия элементов для нескольких потоков. Элементы делятся по хешу между
+// частями (их количество - степень двойки), у каждой части своя блокировка,
+// поэтому потоки, обращающиеся к разным частям, не мешают друг другу.
+// Емкость кэша с вытеснением делится между частями так, что в сумме она равна заданной.
+// Без вытеснения поиск не меняет таблицу части, поэтому читатели блокируют часть совместно
+// и считают попадания атомарными счетчиками; с вытеснением поиск обновляет состояние
+// политики, и часть блокируется монопольно
+template <typename T, typename Eviction = NoEviction, typename Hash = std::hash<T>>
+class ConcurrentCache {
+private:
+    static const bool SHARED_READS = !Eviction::BOUNDED;
+
+    // std::shared_mutex появился только в C++17
+    typedef typename std::conditional<SHARED_READS, std::shared_timed_mutex, std::mutex>::type Lock;
+    typedef typename std::conditional<SHARED_READS, std::shared_lock<Lock>, std::lock_guard<Lock>>::type ReadGuard;
+    typedef std::lock_guard<Lock> WriteGuard;
+
+    // Часть кэша: отдельная блокировка и собственная таблица. Части выделяются по отдельности,
+    // в конце каждой - пустое место размером со строку кэша, чтобы блокировка и счетчики части
+    // не делили строку со следующей частью. alignas(64) здесь не подходит: обычный new
+    // до C++17 не гарантирует выравнивание больше, чем у max_align_t
+    class Shard : public CacheStorage<T, Eviction, Hash> {
+    private:
+        typedef CacheStorage<T, Eviction, Hash> Storage;
+
+        // Попадания и промахи поиска при совместной блокировке
+        mutable std::atomic<uint64_t> sharedHits;
+        mutable std::atomic<uint64_t> sharedMisses;
+
+    public:
+        mutable Lock lock;
+        char padding[64];
+
+        explicit Shard(size_t capacity) : Storage(capacity), sharedHits(0), sharedMisses(0) {}
+
+        // Вызывается под монопольной блокировкой
+        void put(const T& elem) {
+            if (this->access(elem) == Storage::NOT_FOUND) {
+                this->allocate(elem);
+            }
+        }
+
+        // Вызывается под блокировкой ReadGuard
+        bool contains(const T& elem) const {
+            if (!SHARED_READS) {
+                return this->access(elem) != Storage::NOT_FOUND;
+            }
+            bool found = this->locate(elem) != Storage::NOT_FOUND;
+            (found ? sharedHits : sharedMisses).fetch_add(1, std::memory_order_relaxed);
+            return found;
+        }
+
+        CacheStats stats() const {
+            CacheStats total = Storage::stats();
+            total.hits += sharedHits.load(std::memory_order_relaxed);
+            total.misses += sharedMisses.load(std::memory_order_relaxed);
+            return total;
+        }
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shardMask;
+    Hash hasher;
+
+    Shard& shardFor(const T& elem) const {
+        uint64_t hash = static_cast<uint64_t>(hasher(elem)) * 0x9E3779B97F4A7C15ull;
+        return *shards[(hash >> 32) & shardMask];
+    }
+
+    // Количество частей по умолчанию: по 4 на поток процессора, не меньше 16
+    static size_t defaultShards() {
+        return std::max<size_t>(16, 4 * std::thread::hardware_concurrency());
+    }
+
+public:
+    // capacity - наибольшее количество элементов (для кэша с вытеснением),
+    // shardCount - количество частей, округляется вверх до степени двойки.
+    // У кэша с вытеснением частей не больше capacity, чтобы в каждой было хотя бы одно место;
+    // остаток от деления емкости достается первым частям по одному элементу
+    explicit ConcurrentCache(size_t capacity = 0, size_t shardCount = defaultShards()) {
+        if (Eviction::BOUNDED && capacity == 0) {
+            throw std::invalid_argument("Емкость кэша с вытеснением должна быть больше нуля");
+        }
+        size_t count = 1;
+        while (count < shardCount && (!Eviction::BOUNDED || count * 2 <= capacity)) count <<= 1;
+        shardMask = count - 1;
+        for (size_t i = 0; i < count; ++i) {
+            shards.emplace_back(new Shard(Eviction::BOUNDED ? capacity / count + (i < capacity % count) : 0));
+        }
+    }
+
+    // Метод добавления элемента в кэш
+    void put(const T& elem) {
+        Shard& shard = shardFor(elem);
+        WriteGuard guard(shard.lock);
+        shard.put(elem);
+    }
+
+    // Перегрузка оператора += для добавления элемента
+    ConcurrentCache& operator+=(const T& elem) {
+        put(elem);
+        return *this;
+    }
+
+    // Метод проверки наличия элемента в кэше
+    bool contains(const T& elem) const {
+        Shard& shard = shardFor(elem);
+        ReadGuard guard(shard.lock);
+        return shard.contains(elem);
+    }
+
+    // Количество элементов (части блокируются по очереди, поэтому при одновременных
+    // изменениях результат приблизителен)
+    size_t size() const {
+        size_t total = 0;
+        for (const std::unique_ptr<Shard>& shard : shards) {
+            ReadGuard guard(shard->lock);
+            total += shard->size();
+        }
+        return total;
+    }
+
+    // Суммарные счетчики попаданий, промахов и вытеснений
+    CacheStats stats() const {
+        CacheStats total;
+        for (const std::unique_ptr<Shard>& shard : shards) {
+            ReadGuard guard(shard->lock);
+            CacheStats part = shard->stats();
+            total.hits += part.hits;
+            total.misses += part.misses;
+            total.evictions += part.evictions;
+        }
+        return total;
+    }
+};
+
+// Способ сравнения строк в Cache<std::string>
+enum class StringMatch {
+    FirstCharacter,   // Строки совпадают, если совпадают их первые символы
+    Exact             // Строки совпадают полностью
+};
+
+// Явная специализация для std::string. Строки хранятся в префиксном дереве: переход
+// "узел, байт -> дочерний узел" ищется в хеш-индексе, поэтому проверка префикса любой длины
+// стоит O(длина префикса) и не зависит от количества строк. Для сравнения по первому символу
+// дополнительно ведется таблица количества строк для каждого из 256 первых байтов
 template <>
 class Cache<std::string> {
 private:
-    std::vector<std::string> data; // Контейнер для строк
+    typedef HashIndex<uint64_t> EdgeIndex;
+
+    size_t maxEntries; // Наибольшее количество строк (0 - без ограничения)
+    StringMatch match; // Способ сравнения строк
+    size_t entries = 0; // Количество добавленных строк
+
+    uint32_t firstCount[256] = {}; // Количество строк по первому байту
+
+    // Узел 0 - корень, узел e + 1 - конец ребра e
+    std::vector<uint64_t> edgeKeys; // Ключ ребра: (номер родителя << 8) | байт
+    EdgeIndex edges; // Ключ ребра -> номер ребра
+    std::vector<uint32_t> below; // Сколько строк проходит через узел
+    std::vector<uint32_t> terminal; // Сколько строк заканчивается в узле
+
+    // Узел, в который ведет префикс, либо NOT_FOUND
+    uint32_t walk(const std::string& prefix) const {
+        uint32_t node = 0;
+        for (char c : prefix) {
+            uint64_t key = (static_cast<uint64_t>(node) << 8) | static_cast<unsigned char>(c);
+            uint32_t edge = edges.find(key, [this](uint32_t e) -> const uint64_t& { return edgeKeys[e]; });
+            if (edge == EdgeIndex::NOT_FOUND) return EdgeIndex::NOT_FOUND;
+            node = edge + 1;
+        }
+        return node;
+    }
 
 public:
+    // maxEntries - наибольшее количество строк (0 - без ограничения),
+    // match - способ сравнения строк в contains (по умолчанию - по первому символу)
+    explicit Cache(size_t maxEntries = 0, StringMatch match = StringMatch::FirstCharacter)
+        : maxEntries(maxEntries), match(match), below(1, 0), terminal(1, 0) {
+    }
+
     // Специализированный метод добавления строки
     void put(const std::string& elem) {
-        // Если в кэше уже 100 строк, генерируем исключение
-        if (data.size() >= 100) {
+        // Если в кэше уже maxEntries строк, генерируем исключение
+        if (maxEntries != 0 && entries >= maxEntries) {
             throw std::runtime_error("Максимальное количество строк в кэше достигнуто");
         }
-        data.push_back(elem);
+        ++entries;
+        if (!elem.empty()) {
+            ++firstCount[static_cast<unsigned char>(elem[0])];
+        }
+
+        auto keyOf = [this](uint32_t e) -> const uint64_t& { return edgeKeys[e]; };
+        uint32_t node = 0;
+        ++below[0];
+        for (char c : elem) {
+            uint64_t key = (static_cast<uint64_t>(node) << 8) | static_cast<unsigned char>(c);
+            uint32_t edge = edges.find(key, keyOf);
+            if (edge == EdgeIndex::NOT_FOUND) {
+                edge = static_cast<uint32_t>(edgeKeys.size());
+                edgeKeys.push_back(key);
+                edges.insert(key, edge, keyOf);
+                below.push_back(0);
+                terminal.push_back(0);
+            }
+            node = edge + 1;
+            ++below[node];
+        }
+        ++terminal[node];
     }
 
     // Перегрузка оператора += 
@@ -56,18 +985,290 @@ public:
 
     // Специализированный метод проверки наличия строки
     bool contains(const std::string& elem) const {
+        if (match == StringMatch::Exact) {
+            uint32_t node = walk(elem);
+            return node != EdgeIndex::NOT_FOUND && terminal[node] > 0;
+        }
         // Проверяем только первый символ строки
-        for (const auto& str : data) {
-            if (!str.empty() && !elem.empty() && str[0] == elem[0]) {
-                return true;
+        return !elem.empty() && firstCount[static_cast<unsigned char>(elem[0])] > 0;
+    }
+
+    // Есть ли строка, начинающаяся с prefix
+    bool containsPrefix(const std::string& prefix) const {
+        return countPrefix(prefix) > 0;
+    }
+
+    // Количество строк, начинающихся с prefix (с учетом повторов)
+    size_t countPrefix(const std::string& prefix) const {
+        uint32_t node = walk(prefix);
+        return node == EdgeIndex::NOT_FOUND ? 0 : below[node];
+    }
+
+    // Количество добавленных строк (с учетом повторов)
+    size_t size() const { return entries; }
+};
+
+// Самопроверки (запуск с ключом --selftest)
+
+// Нагрузочная проверка ConcurrentCache: потоки добавляют свои диапазоны ключей и сразу
+// проверяют их наличие, одновременно другие потоки добавляют и ищут случайные ключи
+// в кэше с вытеснением, а еще один поток следит за размером и счетчиками кэшей.
+// В конце сверяются размеры кэшей и число учтенных обращений
+bool checkConcurrentCache() {
+    const unsigned THREADS = 8;
+    const int KEYS = 20000;
+    ConcurrentCache<int> unbounded;
+    ConcurrentCache<int, LruEviction> bounded(1024, 16);
+    std::atomic<int> lost(0);
+    std::atomic<bool> stop(false);
+
+    size_t largest = 0;
+    uint64_t observedHits = 0;
+    std::thread observer([&] {
+        while (!stop) {
+            largest = std::max(largest, bounded.size());
+            observedHits = std::max(observedHits, unbounded.stats().hits);
+        }
+    });
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 random(t);
+            for (int i = 0; i < KEYS; ++i) {
+                int key = static_cast<int>(t) * KEYS + i;
+                unbounded.put(key);
+                if (!unbounded.contains(key)) ++lost;
+                bounded.put(static_cast<int>(random() % 5000));
+                bounded.contains(static_cast<int>(random() % 5000));
             }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    stop = true;
+    observer.join();
+
+    // 5000 случайных ключей заполняют все 16 частей по 64 элемента
+    // Без вытеснения каждый ключ добавляется один раз (промах) и затем находится (попадание)
+    CacheStats stats = bounded.stats();
+    CacheStats unboundedStats = unbounded.stats();
+    bool ok = lost == 0 && unbounded.size() == THREADS * KEYS
+        && unboundedStats.hits == 1ull * THREADS * KEYS && unboundedStats.misses == 1ull * THREADS * KEYS
+        && observedHits <= unboundedStats.hits
+        && stats.hits + stats.misses == 2ull * THREADS * KEYS
+        && bounded.size() == 1024 && largest <= 1024;
+
+    if (!ok) {
+        std::cout << "ConcurrentCache: потеряно ключей " << lost << ", размер " << unbounded.size()
+            << ", обращений " << stats.hits + stats.misses << ", размер с вытеснением " << bounded.size() << std::endl;
+    }
+
+    // Емкость меньше количества частей или не делится на него: заданная емкость не превышается
+    for (size_t capacity : { size_t(1), size_t(10), size_t(1000) }) {
+        ConcurrentCache<int, LruEviction> small(capacity, 16);
+        for (int key = 0; key < 10000; ++key) small.put(key);
+        if (small.size() > capacity) {
+            std::cout << "ConcurrentCache: емкость " << capacity << ", размер " << small.size() << std::endl;
+            ok = false;
         }
-        return false;
+    }
+    return ok;
+}
+
+// Все самопроверки режима --selftest, true - если все пройдены
+bool runSelfTests() {
+    bool concurrent = checkConcurrentCache();
+    std::cout << "ConcurrentCache (одновременные обращения): " << (concurrent ? "пройдено" : "ошибка") << std::endl;
+    return concurrent;
+}
+
+// Замеры производительности (запуск с ключом --bench)
+
+// Результаты замеров, чтобы компилятор не удалил вычисления
+volatile long long benchSink = 0;
+
+// Время выполнения действия в наносекундах
+template <typename Action>
+double elapsedNs(Action action) {
+    auto start = std::chrono::steady_clock::now();
+    action();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Прежнее хранение Cache<T>: вектор и поиск перебором. Используется только для сравнения с HashIndex
+template <typename T>
+class LinearSet {
+private:
+    std::vector<T> data;
+
+public:
+    void put(const T& elem) {
+        if (std::find(data.begin(), data.end(), elem) == data.end()) {
+            data.push_back(elem);
+        }
+    }
+
+    bool contains(const T& elem) const {
+        return std::find(data.begin(), data.end(), elem) != data.end();
+    }
+};
+
+// Добавление различных ключей keys и поиск probeCount ключей probes, нс на операцию.
+// Маленькие наборы заполняются многократно (в отдельные объекты), чтобы замер не был слишком коротким
+template <typename Set>
+void benchSet(const std::vector<int>& keys, const std::vector<int>& probes, size_t probeCount,
+    double& putNs, double& containsNs) {
+    std::vector<Set> sets(std::max<size_t>(1, 1000000 / keys.size()));
+    putNs = elapsedNs([&] {
+        for (Set& set : sets) {
+            for (int key : keys) set.put(key);
+        }
+    }) / (sets.size() * keys.size());
+    containsNs = elapsedNs([&] {
+        long long found = 0;
+        for (size_t i = 0; i < probeCount; ++i) found += sets.back().contains(probes[i]);
+        benchSink = benchSink + found;
+    }) / probeCount;
+}
+
+// Cache<int> на HashIndex против перебора вектора для 10..10^7 элементов
+void benchmarkIndex() {
+    std::cout << "Cache<int>, нс на операцию (put / contains):" << std::endl;
+    std::cout << "  элементов      перебор вектора              HashIndex" << std::endl;
+    std::mt19937 random(21);
+    for (size_t n = 10; n <= 10000000; n *= 10) {
+        // Ключи - четные числа вразброс; проверяемые ключи - поровну четные (из набора) и нечетные
+        std::vector<int> keys(n);
+        for (size_t i = 0; i < n; ++i) keys[i] = static_cast<int>(i * 2);
+        std::shuffle(keys.begin(), keys.end(), random);
+        std::vector<int> probes(std::min<size_t>(n * 2, 1000000));
+        for (size_t i = 0; i < probes.size(); ++i) {
+            probes[i] = static_cast<int>(random() % n * 2 + (i & 1));
+        }
+
+        std::cout << "  " << std::setw(9) << n;
+        if (n <= 100000) {
+            double putNs, containsNs;
+            benchSet<LinearSet<int>>(keys, probes, std::min(probes.size(), 1000000000 / n), putNs, containsNs);
+            std::cout << "  " << std::setw(10) << putNs << " / " << std::setw(10) << containsNs;
+        }
+        else {
+            std::cout << "  " << std::setw(23) << "-";
+        }
+
+        double putNs, containsNs;
+        benchSet<Cache<int>>(keys, probes, probes.size(), putNs, containsNs);
+        std::cout << "  " << std::setw(10) << putNs << " / " << std::setw(10) << containsNs << std::endl;
+    }
+}
+
+// Cache<T> под одной общей блокировкой. Используется только для сравнения с ConcurrentCache
+template <typename T>
+class LockedCache {
+private:
+    Cache<T> cache;
+    mutable std::mutex lock;
+
+public:
+    void put(const T& elem) {
+        std::lock_guard<std::mutex> guard(lock);
+        cache.put(elem);
+    }
+
+    bool contains(const T& elem) const {
+        std::lock_guard<std::mutex> guard(lock);
+        return cache.contains(elem);
     }
 };
 
-int main() {
+// Ключи для одновременных обращений: номера 0..2*10^6-1, умноженные на 7919, равномерно
+// либо по закону Ципфа (немногие ключи получают большую часть обращений)
+std::vector<uint64_t> makeKeys(bool zipf) {
+    const size_t COUNT = 1 << 20;
+    const size_t RANGE = 2000000;
+    std::mt19937_64 random(24);
+    std::vector<uint64_t> keys(COUNT);
+    if (zipf) {
+        std::vector<double> weights(RANGE);
+        for (size_t i = 0; i < RANGE; ++i) weights[i] = 1.0 / static_cast<double>(i + 1);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        for (uint64_t& key : keys) key = pick(random) * 7919;
+    }
+    else {
+        for (uint64_t& key : keys) key = random() % RANGE * 7919;
+    }
+    return keys;
+}
+
+// Миллионы операций в секунду: threads потоков обращаются к кэшу Set(args...) с ключами keys,
+// заранее заполненному 10^6 ключами (номера меньше 10^6, то есть частые ключи Ципфа);
+// writePercent процентов операций - добавление, остальные - поиск
+template <typename Set, typename... Args>
+double threadedMops(const std::vector<uint64_t>& keys, unsigned threads, unsigned writePercent, Args... args) {
+    const size_t OPS = 500000;
+    Set set(args...);
+    for (uint64_t i = 0; i < 1000000; ++i) set.put(i * 7919);
+
+    std::vector<std::thread> workers;
+    double ns = elapsedNs([&] {
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&set, &keys, t, writePercent] {
+                std::mt19937 random(t);
+                size_t offset = t * (keys.size() / 8);
+                long long found = 0;
+                for (size_t i = 0; i < OPS; ++i) {
+                    uint64_t key = keys[(offset + i) & (keys.size() - 1)];
+                    if (random() % 100 < writePercent) set.put(key);
+                    else found += set.contains(key);
+                }
+                benchSink = benchSink + found;
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+    });
+    return 1e3 * threads * OPS / ns;
+}
+
+// ConcurrentCache (без вытеснения - с совместной блокировкой для поиска, с LRU - с монопольной)
+// против одной общей блокировки при разной доле записи, числе потоков и распределении ключей
+void benchmarkConcurrency() {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Одновременные обращения, млн операций/с (ядер " << cores << "):" << std::endl;
+    for (bool zipf : { false, true }) {
+        std::vector<uint64_t> keys = makeKeys(zipf);
+        std::cout << (zipf ? "  ключи по закону Ципфа" : "  равномерные ключи") << std::endl;
+        std::cout << "  поиск/запись  потоков  общая блокировка  ConcurrentCache  ConcurrentCache с LRU" << std::endl;
+        for (unsigned writePercent : { 0u, 5u, 50u }) {
+            for (unsigned threads = 1; threads <= std::max(cores, 8u); threads *= 2) {
+                std::cout << "  " << std::setw(5) << 100 - writePercent << "/" << std::left << std::setw(6) << writePercent
+                    << std::right << std::setw(8) << threads
+                    << std::setw(18) << threadedMops<LockedCache<uint64_t>>(keys, threads, writePercent)
+                    << std::setw(17) << threadedMops<ConcurrentCache<uint64_t>>(keys, threads, writePercent)
+                    << std::setw(23) << threadedMops<ConcurrentCache<uint64_t, LruEviction>>(keys, threads, writePercent,
+                        size_t(1000000)) << std::endl;
+            }
+        }
+    }
+}
+
+// Все замеры режима --bench
+void runBenchmarks() {
+    std::cout << std::fixed << std::setprecision(1);
+    benchmarkIndex();
+    benchmarkConcurrency();
+}
+
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "Russian");
+
+    // Самопроверки или замеры производительности вместо демонстрации
+    if (argc > 1 && std::string(argv[1]) == "--selftest") {
+        return runSelfTests() ? 0 : 1;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmarks();
+        return 0;
+    }
+
     // Создаем кэш для целых чисел
     Cache<int> cache;
     cache.put(1);       // Добавление элемента через put()